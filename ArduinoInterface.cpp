@@ -15,7 +15,9 @@ namespace nRF24L01 {
     void ArduinoInterface::begin() {
         SPI.begin();
         // Convert the pin number to the interrupt
-        SPI.usingInterrupt( digitalPinToInterrupt(_IRQPin) );
+        if(_IRQPin != SpecialPinHolder::NO_PIN) {
+            SPI.usingInterrupt( digitalPinToInterrupt(_IRQPin) );
+        }
         pinMode(_CSNPin, OUTPUT);
         digitalWrite(_CSNPin, HIGH);
     }
@@ -47,6 +49,9 @@ namespace nRF24L01 {
     void ArduinoInterface::delayMicroseconds(unsigned int d) {
         ::delayMicroseconds(d);
     }
+    unsigned long ArduinoInterface::micros() {
+        return ::micros();
+    }
     
     void ArduinoInterface::writeCSNHigh() {
         digitalWrite(_CSNPin, HIGH);
@@ -60,4 +65,53 @@ namespace nRF24L01 {
     void ArduinoInterface::writeCELow() {
         digitalWrite(_CEPin, LOW);
     }
+    
+    bool ArduinoInterface::tryLockBus() {
+        bool locked = false;
+        enterCritical();
+        if(_busLockDepth == 0) {
+            _busLockDepth = 1;
+            locked = true;
+        }
+        exitCritical();
+        return locked;
+    }
+    void ArduinoInterface::lockBus() {
+        // Interrupts always run to completion, so outside of one the bus is either free or already owned by the main loop.
+        enterCritical();
+        _busLockDepth++;
+        exitCritical();
+    }
+    void ArduinoInterface::unlockBus() {
+        enterCritical();
+        _busLockDepth--;
+        exitCritical();
+    }
+    void ArduinoInterface::enterCritical() {
+    #if defined(__AVR__)
+        // Restore the previous state afterwards so this doesn't turn interrupts back on inside an interrupt.
+        unsigned char state = SREG;
+        cli();
+        _savedInterruptState = state;
+    #elif defined(__arm__)
+        // Same for Cortex-M boards, where PRIMASK is set while interrupts are off.
+        unsigned long primask;
+        __asm__ volatile("mrs %0, primask" : "=r" (primask));
+        __asm__ volatile("cpsid i" : : : "memory");
+        _savedInterruptState = primask;
+    #else
+        // Other boards don't say whether interrupts were on, so this assumes they were.
+        noInterrupts();
+    #endif
+    }
+    void ArduinoInterface::exitCritical() {
+    #if defined(__AVR__)
+        SREG = _savedInterruptState;
+    #elif defined(__arm__)
+        unsigned long primask = _savedInterruptState;
+        __asm__ volatile("msr primask, %0" : : "r" (primask) : "memory");
+    #else
+        interrupts();
+    #endif
+    }
 }
@@ -25,17 +25,25 @@ namespace nRF24L01 {
         
         void delay(unsigned int d);
         void delayMicroseconds(unsigned int d);
+        unsigned long micros();
         
         void writeCSNHigh();
         void writeCSNLow();
         void writeCEHigh();
         void writeCELow();
         
-        ArduinoInterface(SpecialPinHolder *s): NRF24L01Interface(s) {
+        bool tryLockBus();
+        void lockBus();
+        void unlockBus();
+        void enterCritical();
+        void exitCritical();
+        
+        ArduinoInterface(SpecialPinHolder *s): NRF24L01Interface(s), _busLockDepth(0), _savedInterruptState(0) {
             
         }
     private:
-        
+        volatile unsigned char _busLockDepth;
+        unsigned char _savedInterruptState;
     };
 }
 
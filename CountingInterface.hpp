@@ -0,0 +1,88 @@
+//
+//  CountingInterface.hpp
+//
+//
+//
+
+#ifndef CountingInterface_hpp
+#define CountingInterface_hpp
+
+#include "NRF24L01Interface.hpp"
+
+namespace nRF24L01 {
+
+    /**
+     What talking to the nRF has cost so far.
+     */
+    struct SPICost {
+        // beginTransaction/endTransaction pairs
+        unsigned long transactions;
+        // Bytes clocked over SPI in either direction
+        unsigned long bytes;
+        // Writes to the CSN pin
+        unsigned long CSNToggles;
+        // Time spent in delay and delayMicroseconds
+        unsigned long delayMicroseconds;
+    };
+
+
+    /**
+     Wraps another interface and counts every SPI transaction, byte, CSN toggle and delay going through it,
+     e.g. `Controller<CountingInterface<ArduinoInterface>>`. Get the counts with `controller->getInterface()->getCost()`.
+     */
+    template <class Base>
+    class CountingInterface : public Base {
+    public:
+        CountingInterface(SpecialPinHolder *s): Base(s) {
+            resetCost();
+        }
+
+        /**
+         @return The cost counted since the interface was created or `resetCost` was last called.
+         */
+        const SPICost &getCost() const {
+            return _cost;
+        }
+
+        void resetCost() {
+            _cost = SPICost();
+        }
+
+        void beginTransaction() {
+            _cost.transactions++;
+            Base::beginTransaction();
+        }
+
+        unsigned char transferByte(unsigned char b) {
+            _cost.bytes++;
+            return Base::transferByte(b);
+        }
+        void transferBytes(unsigned char **b, unsigned char size) {
+            _cost.bytes += size;
+            Base::transferBytes(b, size);
+        }
+
+        void delay(unsigned int d) {
+            _cost.delayMicroseconds += d * 1000UL;
+            Base::delay(d);
+        }
+        void delayMicroseconds(unsigned int d) {
+            _cost.delayMicroseconds += d;
+            Base::delayMicroseconds(d);
+        }
+
+        void writeCSNHigh() {
+            _cost.CSNToggles++;
+            Base::writeCSNHigh();
+        }
+        void writeCSNLow() {
+            _cost.CSNToggles++;
+            Base::writeCSNLow();
+        }
+
+    private:
+        SPICost _cost;
+    };
+}
+
+#endif /* CountingInterface_hpp */
@@ -0,0 +1,60 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+
+// Broadcasts the same packet over and over (pair it with the Receiver example.)
+// The payload is only sent over SPI once per second, every repeat in between is just a pulse on the CE pin.
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+
+volatile unsigned long beaconsSent = 0;
+
+void handleInterrupt(nRF24L01::Controller<nRF24L01::ArduinoInterface> *controller, void *context) {
+    controller->readAndClearInterruptBits();
+    if (controller->didSendPayload()) {
+        beaconsSent++;
+        // Send the same payload again, if there are repeats left.
+        controller->continueRepeatingPacket();
+    }
+}
+void nrfInterrupt() {
+    // Runs right away, or as soon as the loop is done uploading a new beacon.
+    n->submit(handleInterrupt);
+}
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, 2, 10);
+    attachInterrupt(digitalPinToInterrupt(2), nrfInterrupt, FALLING);
+
+    n->setPoweredUp(true);
+    n->setPrimaryTransmitter();
+    unsigned char addr[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+    n->setAddress(addr, 3);
+
+    n->setAutoAcknowledgementEnabled(false);
+    n->setUsesDynamicPayloadLength(false);
+    // Beacons are sent without an ACK.
+    n->setDynamicACKEnabled(true);
+    n->setBitrate(2);
+    n->setAutoRetransmitCount(0);
+}
+
+void loop() {
+    // Upload a new beacon with the current time once per second and repeat it 500 times.
+    unsigned char beacon[32] = "Beacon ";
+    unsigned long now = millis();
+    beacon[7] = now >> 24;
+    beacon[8] = now >> 16;
+    beacon[9] = now >> 8;
+    beacon[10] = now;
+    n->startRepeatingPacket(beacon, 32, 500);
+
+    delay(1000);
+
+    Serial.print("beacons sent: ");
+    Serial.println(beaconsSent);
+}
@@ -0,0 +1,110 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+#include "PeerTable.hpp"
+
+// Sends packets round robin to 8 receivers, first writing the whole address before every send (what setAddress
+// did before it remembered the addresses), then calling setAddress before every send, then through a PeerTable,
+// and prints the packets per second for each.
+// Packets are sent without an ACK, so this works even without any receivers turned on.
+
+const unsigned char PEER_COUNT = 8;
+const unsigned int PACKETS = 800;
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+nRF24L01::PeerTable<nRF24L01::ArduinoInterface, PEER_COUNT, 16> *peers;
+
+// The receivers' addresses only differ in their first byte.
+unsigned char addresses[PEER_COUNT][5];
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2 (not used, sends are polled)
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setPrimaryTransmitter();
+    n->setAutoAcknowledgementEnabled(false);
+    n->setUsesDynamicPayloadLength(false);
+    n->setDynamicACKEnabled(true);
+    n->setBitrate(2);
+    n->setAutoRetransmitCount(0);
+
+    peers = new nRF24L01::PeerTable<nRF24L01::ArduinoInterface, PEER_COUNT, 16>(n);
+    for (unsigned char i = 0; i < PEER_COUNT; i++) {
+        addresses[i][0] = 0x10 + i;
+        addresses[i][1] = 0x34;
+        addresses[i][2] = 0x56;
+        addresses[i][3] = 0x78;
+        addresses[i][4] = 0x9A;
+        peers->setPeer(i, addresses[i], 5);
+    }
+}
+
+// Writes SETUP_AW, TX_ADDR and RX_ADDR_P0 in full, without looking at what the nRF already has.
+void writeFullAddress(const unsigned char address[5]) {
+    nRF24L01::ArduinoInterface *interface = n->getInterface();
+    // W_REGISTER | SETUP_AW, 5 byte addresses
+    interface->beginTransaction();
+    interface->transferByte(0x20 | 0x03);
+    interface->transferByte(0x03);
+    interface->endTransaction();
+    const unsigned char registers[] = {0x10, 0x0A};
+    for (unsigned char r = 0; r < 2; r++) {
+        unsigned char data[5];
+        unsigned char *pointer = data;
+        for (unsigned char i = 0; i < 5; i++) {
+            data[i] = address[i];
+        }
+        interface->beginTransaction();
+        interface->transferByte(0x20 | registers[r]);
+        interface->transferBytes(&pointer, 5);
+        interface->endTransaction();
+    }
+}
+
+void loop() {
+    unsigned char packet[32];
+
+    // Writing the whole address before every send.
+    unsigned long start = micros();
+    for (unsigned int i = 0; i < PACKETS; i++) {
+        writeFullAddress(addresses[i % PEER_COUNT]);
+        n->sendPacketAndWait(packet, 32, true);
+    }
+    unsigned long fullWriteMicros = micros() - start;
+    // The addresses were written behind setAddress's back. Switching the width makes it forget the ones it remembers.
+    n->setAddress(addresses[0], 3);
+
+    // Switching the address before every send.
+    start = micros();
+    for (unsigned int i = 0; i < PACKETS; i++) {
+        n->setAddress(addresses[i % PEER_COUNT], 5);
+        n->sendPacketAndWait(packet, 32, true);
+    }
+    unsigned long setAddressMicros = micros() - start;
+
+    // Queueing the same packets in the peer table. Every flush sends two rounds, grouped by destination,
+    // so only every other packet needs an address switch.
+    start = micros();
+    for (unsigned int i = 0; i < PACKETS; i++) {
+        if (!peers->queue(i % PEER_COUNT, packet, 32, true)) {
+            peers->flush();
+            peers->queue(i % PEER_COUNT, packet, 32, true);
+        }
+    }
+    peers->flush();
+    unsigned long peerTableMicros = micros() - start;
+
+    Serial.print("full address write before each send: ");
+    Serial.print(PACKETS * 1000000.0 / fullWriteMicros);
+    Serial.print(" packets/s, setAddress before each send: ");
+    Serial.print(PACKETS * 1000000.0 / setAddressMicros);
+    Serial.print(" packets/s, peer table: ");
+    Serial.print(PACKETS * 1000000.0 / peerTableMicros);
+    Serial.print(" packets/s, address switches: ");
+    Serial.println(peers->getStatistics().addressSwitches);
+
+    delay(1000);
+}
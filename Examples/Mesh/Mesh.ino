@@ -0,0 +1,67 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+#include "Mesh.hpp"
+
+// Change this for every node you upload the sketch to.
+// Node 0 is the root, every other node uses the node below it as its parent,
+// so frames from node 3 to node 0 hop 3 -> 2 -> 1 -> 0.
+const unsigned char NODE_ID = 0;
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+nRF24L01::MeshNode<nRF24L01::ArduinoInterface> *mesh;
+
+// Called by "poll" whenever a frame for this node arrives.
+void received(unsigned char source, unsigned char *data, unsigned char size) {
+    Serial.print("From node ");
+    Serial.print(source);
+    Serial.print(": ");
+    for (byte i = 0; i < size; i++) {
+        Serial.print((char)data[i]);
+    }
+    Serial.println();
+}
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2 (the mesh polls the nRF, so no interrupt routine is needed)
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setBitrate(2);
+    // Every hop is acknowledged, so let the nRF retry a few times before the mesh drops a frame.
+    n->setAutoAcknowledgementEnabled(true);
+    n->setAutoRetransmitCount(5);
+
+    // All nodes share the same 4 byte network prefix, the node ID makes up the last address byte.
+    const unsigned char prefix[] = {0x34, 0x56, 0x78, 0x9A};
+    mesh = new nRF24L01::MeshNode<nRF24L01::ArduinoInterface>(n, NODE_ID, prefix);
+    mesh->setDeliveryHandler(received);
+    if (NODE_ID > 0) {
+        mesh->setParent(NODE_ID - 1);
+    }
+    mesh->begin();
+}
+
+unsigned long lastSend = 0;
+void loop() {
+    // Read, forward and send frames.
+    mesh->poll();
+
+    if (NODE_ID > 0 && millis() - lastSend > 1000) {
+        lastSend = millis();
+        // Let the parent know which nodes can be reached through us, then say hello to the root.
+        mesh->advertiseRoutes(NODE_ID - 1);
+        const unsigned char text[] = "Hello root!";
+        mesh->send(0, text, sizeof(text) - 1);
+
+        const nRF24L01::MeshNode<nRF24L01::ArduinoInterface>::Statistics &stats = mesh->getStatistics();
+        Serial.print("forwarded: ");
+        Serial.print(stats.forwarded);
+        Serial.print(" dropped: ");
+        Serial.print(stats.dropped);
+        Serial.print(" last hop latency (us): ");
+        Serial.println(stats.lastHopLatency);
+    }
+}
@@ -0,0 +1,59 @@
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+
+// A receiver for boards without a free interrupt pin (pair it with the Sender example.)
+// The nRF is busy polled while packets keep arriving and only checked every millisecond once traffic stops.
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+
+unsigned char dataIn[32];
+unsigned long packetsReceived = 0;
+unsigned long packetsReceivedWhileBusy = 0;
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = none
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, nRF24L01::SpecialPinHolder::NO_PIN, 10);
+    n->setPoweredUp(true);
+    n->setPrimaryReceiver();
+    unsigned char addr[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+    n->setAddress(addr, 3);
+
+    n->setAutoAcknowledgementEnabled(false);
+    n->setUsesDynamicPayloadLength(false);
+    n->setBitrate(2);
+    n->setReceivedPacketLength(32);
+
+    // Busy poll until 200 polls in a row find nothing, then poll every 1000us.
+    n->setIRQMode(nRF24L01::Controller<nRF24L01::ArduinoInterface>::IRQMode::Hybrid, 200, 1000);
+}
+
+unsigned long lastPrint = 0;
+void loop() {
+    // Check before polling: the poll that finds the first packet of a burst already switches to busy polling.
+    bool busy = n->isBusyPolling();
+    if (n->pollInterruptBits() && n->didReceivePayload()) {
+        // Several packets may have arrived since the last poll.
+        while (n->dataInRXFIFO()) {
+            n->readData(dataIn, 32);
+            packetsReceived++;
+            if (busy) {
+                packetsReceivedWhileBusy++;
+            }
+        }
+    }
+
+    // Print the packets per second, and how many of them were picked up while busy polling.
+    if (millis() - lastPrint >= 1000) {
+        lastPrint = millis();
+        Serial.print("packets/s: ");
+        Serial.print(packetsReceived);
+        Serial.print(" (busy polling: ");
+        Serial.print(packetsReceivedWhileBusy);
+        Serial.println(")");
+        packetsReceived = 0;
+        packetsReceivedWhileBusy = 0;
+    }
+}
@@ -0,0 +1,72 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+#include "PrioritySender.hpp"
+
+// Streams bulk data as fast as the nRF can send it and slips in a control packet every 250ms
+// (pair it with the Receiver example.) Every second it prints the bulk packets per second and how long
+// control packets took to go out, which stays around a single packet's air time no matter how much bulk data is queued.
+
+typedef nRF24L01::PrioritySender<nRF24L01::ArduinoInterface> Sender;
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+Sender *sender;
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2 (not used, the sender is serviced from the loop)
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setPrimaryTransmitter();
+    // Must match the receiver
+    unsigned char addr[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+    n->setAddress(addr, 3);
+    n->setAutoAcknowledgementEnabled(false);
+    n->setUsesDynamicPayloadLength(false);
+    n->setBitrate(2);
+
+    sender = new Sender(n);
+    // Send 4 normal packets for every bulk packet (the default, shown here for completeness.)
+    sender->setWeight(Sender::Priority::Normal, 4);
+    sender->setWeight(Sender::Priority::Bulk, 1);
+}
+
+unsigned long lastControl = 0;
+unsigned long lastPrint = 0;
+unsigned long lastBulkSent = 0;
+void loop() {
+    // Check what's been sent and keep the TX FIFO topped up.
+    sender->service();
+
+    // Keep the bulk queue full.
+    unsigned char bulk[32];
+    for (byte i = 0; i < 32; i++) {
+        bulk[i] = 'b';
+    }
+    while (sender->queue(Sender::Priority::Bulk, bulk, 32)) {
+    }
+
+    // This goes out right away, pushing the queued bulk packets out of the TX FIFO.
+    if (millis() - lastControl >= 250) {
+        lastControl = millis();
+        unsigned char control[32] = "Control!";
+        sender->queue(Sender::Priority::Control, control, 32);
+    }
+
+    if (millis() - lastPrint >= 1000) {
+        lastPrint = millis();
+        const Sender::Statistics &stats = sender->getStatistics();
+        unsigned long bulkSent = stats.packetsSent[(byte)Sender::Priority::Bulk];
+        Serial.print("bulk packets/s: ");
+        Serial.print(bulkSent - lastBulkSent);
+        Serial.print(" control latency (us) last: ");
+        Serial.print(stats.lastControlLatency);
+        Serial.print(" max: ");
+        Serial.print(stats.maxControlLatency);
+        Serial.print(" preemptions: ");
+        Serial.println(stats.preemptions);
+        lastBulkSent = bulkSent;
+    }
+}
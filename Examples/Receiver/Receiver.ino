@@ -8,23 +8,32 @@ nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
 volatile byte lastPacketSize = 0;
 volatile unsigned char dataOut[32];
 volatile unsigned long bytesReceived = 0;
-void readData() {
+// Runs while owning the nRF, so the interrupt and the loop can never read at the same time.
+void readData(nRF24L01::Controller<nRF24L01::ArduinoInterface> *controller, void *context) {
+    // Make sure there's still a packet, the other side may have read it first.
+    if (!controller->dataInRXFIFO()) {
+        return;
+    }
     // Get the size of the packet thats in the receiving FIFO
-    unsigned char packetSize = n->getNextPacketSize();
+    unsigned char packetSize = controller->getNextPacketSize();
     // Read the data from the nRF
-    n->readData((unsigned char *)dataOut, packetSize);
+    controller->readData((unsigned char *)dataOut, packetSize);
     // Inrecement the total number of bytes we received
     bytesReceived += packetSize;
 }
-void nrfInterrupt() {
+void handleInterrupt(nRF24L01::Controller<nRF24L01::ArduinoInterface> *controller, void *context) {
     // Get and clear the interrupt bits.
-    n->readAndClearInterruptBits();
+    controller->readAndClearInterruptBits();
     // Did the nRF receive data that it wants us to read?
-    if (n->didReceivePayload()) {
+    if (controller->didReceivePayload()) {
         // Read the data.
-        readData();
+        readData(controller, context);
     }
 }
+void nrfInterrupt() {
+    // If the loop is using the nRF right now, this runs as soon as it's done instead.
+    n->submit(handleInterrupt);
+}
 
 void setup() {
     // Start serial
@@ -66,9 +75,7 @@ void loop() {
     Serial.println(bytesReceived);
 
     // Make sure there isn't data we missed in the internal receiving FIFO.
-    if (n->dataInRXFIFO()) {
-        readData();
-    }
+    n->submit(readData);
     // Wait a little
     delay(1000);
 }
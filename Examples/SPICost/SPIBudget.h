@@ -0,0 +1,63 @@
+//
+//  SPIBudget.h
+//
+//  The most each public Controller call and common flow is allowed to cost on the SPI bus.
+//  The SPICost sketch and Tests/SPICostTest fail when a call goes over its budget. Only lower these numbers,
+//  unless a change really needs to make a call chattier.
+//
+
+#ifndef SPIBudget_h
+#define SPIBudget_h
+
+struct SPIBudget {
+    const char *name;
+    unsigned long transactions;
+    unsigned long bytes;
+    unsigned long CSNToggles;
+    unsigned long delayMicroseconds;
+};
+
+const SPIBudget budgets[] = {
+    // name                             transactions  bytes  CSN toggles  delay (us)
+    { "Controller",                     2,            3,     4,           100000 },
+    { "setPoweredUp(true)",             2,            4,     4,           2000 },
+    { "setPoweredUp(false)",            2,            4,     4,           0 },
+    { "setPrimaryTransmitter",          2,            4,     4,           0 },
+    { "setPrimaryReceiver",             2,            4,     4,           0 },
+    { "setAutoAcknowledgementEnabled",  1,            2,     2,           0 },
+    { "setUsesDynamicPayloadLength",    3,            6,     6,           0 },
+    { "setDynamicACKEnabled",           2,            4,     4,           0 },
+    { "setReceivedPacketLength",        1,            2,     2,           0 },
+    { "setAddress",                     3,            14,    6,           0 },
+    { "setAddress (same address)",      0,            0,     0,           0 },
+    { "setAddress (first byte changed)", 2,           4,     4,           0 },
+    { "setChannel",                     1,            2,     2,           0 },
+    { "setCRCEnabled",                  2,            4,     4,           0 },
+    { "setBitrate",                     2,            4,     4,           0 },
+    { "setAutoRetransmitCount",         2,            4,     4,           0 },
+    { "startSendingPacket",             1,            33,    2,           0 },
+    { "concludeSendingPacket",          0,            0,     0,           0 },
+    { "getNextPacketSize",              1,            2,     2,           0 },
+    { "readData",                       1,            33,    2,           0 },
+    { "flushRXFIFO",                    1,            1,     2,           0 },
+    { "flushTXFIFO",                    1,            1,     2,           0 },
+    // Upload, a STATUS read every 20us until it's sent (about 300us at 2Mbps without an ACK), clearing TX_DS
+    { "sendPacketAndWait",              16,           49,    32,          300 },
+    { "getStatusAndConfigRegisters",    1,            2,     2,           0 },
+    { "getFIFOStatus",                  1,            2,     2,           0 },
+    { "dataInRXFIFO",                   1,            2,     2,           0 },
+    { "dataInTXFIFO",                   1,            2,     2,           0 },
+    { "readAndClearInterruptBits",      1,            2,     2,           0 },
+    { "setIRQMode",                     2,            4,     4,           0 },
+    { "pollInterruptBits",              1,            1,     2,           0 },
+    { "startRepeatingPacket",           3,            35,    6,           10 },
+    { "continueRepeatingPacket",        0,            0,     0,           10 },
+    { "isReusingTXPayload",             1,            2,     2,           0 },
+    { "cancelRepeatingPacket",          1,            1,     2,           0 },
+    // Common flows
+    { "send one packet",                2,            35,    4,           0 },
+    { "receive one packet",             3,            37,    6,           0 },
+    { "role switch",                    2,            4,     4,           0 },
+};
+
+#endif /* SPIBudget_h */
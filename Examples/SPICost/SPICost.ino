@@ -0,0 +1,59 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+#include "CountingInterface.hpp"
+#include "SPICostSteps.h"
+
+// Counts what every public Controller call and a few common flows cost on the SPI bus
+// and checks the counts against the budgets in SPIBudget.h.
+// Run this after changing the library: any call that got chattier is reported as FAIL.
+// The same steps run on a computer with `make -C Tests test`.
+
+typedef SPICostSteps<nRF24L01::ArduinoInterface> Steps;
+Steps::Controller *n;
+
+unsigned int failures = 0;
+
+// Compares the cost counted since the last reset with the budget called "name".
+void check(const char *name) {
+    const nRF24L01::SPICost &cost = n->getInterface()->getCost();
+    bool passed = withinBudget(name, cost);
+    if (!passed) {
+        failures++;
+    }
+
+    Serial.print(passed ? "PASS " : "FAIL ");
+    Serial.print(name);
+    Serial.print(": transactions ");
+    Serial.print(cost.transactions);
+    Serial.print(", bytes ");
+    Serial.print(cost.bytes);
+    Serial.print(", CSN toggles ");
+    Serial.print(cost.CSNToggles);
+    Serial.print(", delay (us) ");
+    Serial.println(cost.delayMicroseconds);
+}
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2
+    // Chip select pin (for SPI) = 10
+    n = new Steps::Controller(8, 2, 10);
+    check("Controller");
+    n->setPoweredUp(true);
+
+    unsigned int count;
+    const Steps::Step *steps = Steps::getSteps(count);
+    for (unsigned int i = 0; i < count; i++) {
+        n->getInterface()->resetCost();
+        steps[i].run(n);
+        check(steps[i].name);
+    }
+
+    Serial.print(failures);
+    Serial.println(failures == 0 ? " failures, all within budget." : " failures, see above.");
+}
+
+void loop() {
+}
@@ -0,0 +1,158 @@
+//
+//  SPICostSteps.h
+//
+//  Every public Controller call and common flow that SPIBudget.h has a budget for, in the order they're measured.
+//  Shared by the SPICost sketch and the host test (Tests/SPICostTest.cpp), so both check exactly the same calls.
+//
+
+#ifndef SPICostSteps_h
+#define SPICostSteps_h
+
+#include <string.h>
+#include "nRF24L01.hpp"
+#include "CountingInterface.hpp"
+#include "SPIBudget.h"
+
+/**
+ @return `true` if `cost` is within the budget called `name`. A step without a budget always fails.
+ */
+inline bool withinBudget(const char *name, const nRF24L01::SPICost &cost) {
+    for (unsigned int i = 0; i < sizeof(budgets) / sizeof(budgets[0]); i++) {
+        if (strcmp(budgets[i].name, name) == 0) {
+            return cost.transactions <= budgets[i].transactions &&
+                cost.bytes <= budgets[i].bytes &&
+                cost.CSNToggles <= budgets[i].CSNToggles &&
+                cost.delayMicroseconds <= budgets[i].delayMicroseconds;
+        }
+    }
+    return false;
+}
+
+template <class Interface>
+struct SPICostSteps {
+    typedef nRF24L01::Controller<nRF24L01::CountingInterface<Interface> > Controller;
+
+    struct Step {
+        const char *name;
+        void (*run)(Controller *n);
+    };
+
+    static unsigned char *address() {
+        static unsigned char addr[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+        return addr;
+    }
+    static unsigned char *packet() {
+        static unsigned char data[32];
+        return data;
+    }
+
+    static void setPoweredUpTrue(Controller *n) { n->setPoweredUp(true); }
+    static void setPoweredUpFalse(Controller *n) { n->setPoweredUp(false); }
+    static void setPrimaryTransmitter(Controller *n) { n->setPrimaryTransmitter(); }
+    static void setPrimaryReceiver(Controller *n) { n->setPrimaryReceiver(); }
+    static void setAutoAcknowledgementEnabled(Controller *n) { n->setAutoAcknowledgementEnabled(false); }
+    static void setUsesDynamicPayloadLength(Controller *n) { n->setUsesDynamicPayloadLength(false); }
+    static void setDynamicACKEnabled(Controller *n) { n->setDynamicACKEnabled(true); }
+    static void setReceivedPacketLength(Controller *n) { n->setReceivedPacketLength(32); }
+    static void setAddress(Controller *n) { n->setAddress(address(), 5); }
+    static void setAddressChangingFirstByte(Controller *n) {
+        address()[0]++;
+        n->setAddress(address(), 5);
+    }
+    static void setChannel(Controller *n) { n->setChannel(2); }
+    static void setCRCEnabled(Controller *n) { n->setCRCEnabled(true); }
+    static void setBitrate(Controller *n) { n->setBitrate(2); }
+    static void setAutoRetransmitCount(Controller *n) { n->setAutoRetransmitCount(0); }
+    static void startSendingPacket(Controller *n) { n->startSendingPacket(packet(), 32); }
+    static void concludeSendingPacket(Controller *n) { n->concludeSendingPacket(); }
+    static void getNextPacketSize(Controller *n) { n->getNextPacketSize(); }
+    static void readData(Controller *n) { n->readData(packet(), 32); }
+    static void flushRXFIFO(Controller *n) { n->flushRXFIFO(); }
+    static void flushTXFIFO(Controller *n) { n->flushTXFIFO(); }
+    static void sendPacketAndWait(Controller *n) { n->sendPacketAndWait(packet(), 32, true); }
+    static void getStatusAndConfigRegisters(Controller *n) { n->getStatusAndConfigRegisters(); }
+    static void getFIFOStatus(Controller *n) { n->getFIFOStatus(); }
+    static void dataInRXFIFO(Controller *n) { n->dataInRXFIFO(); }
+    static void dataInTXFIFO(Controller *n) { n->dataInTXFIFO(); }
+    static void readAndClearInterruptBits(Controller *n) { n->readAndClearInterruptBits(); }
+    static void setIRQMode(Controller *n) { n->setIRQMode(Controller::IRQMode::Polling); }
+    static void pollInterruptBits(Controller *n) { n->pollInterruptBits(); }
+    static void startRepeatingPacket(Controller *n) { n->startRepeatingPacket(packet(), 32); }
+    static void continueRepeatingPacket(Controller *n) { n->continueRepeatingPacket(); }
+    static void isReusingTXPayload(Controller *n) { n->isReusingTXPayload(); }
+    static void cancelRepeatingPacket(Controller *n) { n->cancelRepeatingPacket(); }
+
+    // What the Sender example does for each packet.
+    static void sendOnePacket(Controller *n) {
+        n->startSendingPacket(packet(), 32);
+        n->readAndClearInterruptBits();
+        n->concludeSendingPacket();
+    }
+    // What the Receiver example does for each packet.
+    static void receiveOnePacket(Controller *n) {
+        n->readAndClearInterruptBits();
+        unsigned char size = n->getNextPacketSize();
+        n->readData(packet(), size);
+    }
+    // Going from sending back to listening.
+    static void roleSwitch(Controller *n) {
+        n->concludeSendingPacket();
+        n->setPrimaryReceiver();
+        n->setAddress(address(), 5);
+    }
+
+    /**
+     @param count Set to the number of steps.
+     @return The steps, to be run in order on a powered up controller.
+     */
+    static const Step *getSteps(unsigned int &count) {
+        static const Step steps[] = {
+            // Powered up beforehand, so power down first.
+            { "setPoweredUp(false)", setPoweredUpFalse },
+            { "setPoweredUp(true)", setPoweredUpTrue },
+            // Leaves the nRF a primary transmitter, which is the more expensive case for setAddress.
+            { "setPrimaryReceiver", setPrimaryReceiver },
+            { "setPrimaryTransmitter", setPrimaryTransmitter },
+            { "setAutoAcknowledgementEnabled", setAutoAcknowledgementEnabled },
+            { "setUsesDynamicPayloadLength", setUsesDynamicPayloadLength },
+            { "setDynamicACKEnabled", setDynamicACKEnabled },
+            { "setReceivedPacketLength", setReceivedPacketLength },
+            { "setAddress", setAddress },
+            { "setAddress (same address)", setAddress },
+            // Switching between peers that only differ in the first (least significant) byte.
+            { "setAddress (first byte changed)", setAddressChangingFirstByte },
+            { "setChannel", setChannel },
+            { "setCRCEnabled", setCRCEnabled },
+            { "setBitrate", setBitrate },
+            { "setAutoRetransmitCount", setAutoRetransmitCount },
+            { "startSendingPacket", startSendingPacket },
+            { "concludeSendingPacket", concludeSendingPacket },
+            { "getNextPacketSize", getNextPacketSize },
+            { "readData", readData },
+            { "flushRXFIFO", flushRXFIFO },
+            { "flushTXFIFO", flushTXFIFO },
+            // Without an ACK, so it finishes without a receiver around.
+            { "sendPacketAndWait", sendPacketAndWait },
+            { "getStatusAndConfigRegisters", getStatusAndConfigRegisters },
+            { "getFIFOStatus", getFIFOStatus },
+            { "dataInRXFIFO", dataInRXFIFO },
+            { "dataInTXFIFO", dataInTXFIFO },
+            { "readAndClearInterruptBits", readAndClearInterruptBits },
+            // Busy polling with nothing happening, the common case while waiting.
+            { "setIRQMode", setIRQMode },
+            { "pollInterruptBits", pollInterruptBits },
+            // Each repeat should only pulse CE.
+            { "startRepeatingPacket", startRepeatingPacket },
+            { "continueRepeatingPacket", continueRepeatingPacket },
+            { "isReusingTXPayload", isReusingTXPayload },
+            { "cancelRepeatingPacket", cancelRepeatingPacket },
+            { "send one packet", sendOnePacket },
+            { "receive one packet", receiveOnePacket },
+            { "role switch", roleSwitch },
+        };
+        count = sizeof(steps) / sizeof(steps[0]);
+        return steps;
+    }
+};
+
+#endif /* SPICostSteps_h */
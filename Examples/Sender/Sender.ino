@@ -8,24 +8,29 @@ nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
 // Any variables that get changed in an interrupt should be marked "volatile".
 volatile unsigned char lastInterruptBits = 0;
 volatile bool readyForMoreData = true;
-// The IRQ pin will output LOW when the nRF has something important for us to handle.
-// This interrupt gets triggered when the IRQ pin goes low.
-void nrfInterrupt() {
+// Runs while owning the nRF, so it never cuts into a call the loop is making.
+void handleInterrupt(nRF24L01::Controller<nRF24L01::ArduinoInterface> *controller, void *context) {
     // Set the CE pin LOW to complete the send.
-    n->concludeSendingPacket();
+    controller->concludeSendingPacket();
     // Read and clear the interrupt bits.
-    n->readAndClearInterruptBits();
+    controller->readAndClearInterruptBits();
 
-    if(n->didSendPayload()) {
+    if(controller->didSendPayload()) {
         // The payload successfully sent!
         readyForMoreData = true;
-    } else if(n->didHitMaxRetry()) {
+    } else if(controller->didHitMaxRetry()) {
         // The nRF tried to resend the payload multiple times but the other side never received it.
         // (Note: this should only happen when ACK is enabled on both sides. In this
         //   example program, ACK is disabled, so we'll never get to this condition.)
         readyForMoreData = true;
     }
 }
+// The IRQ pin will output LOW when the nRF has something important for us to handle.
+// This interrupt gets triggered when the IRQ pin goes low.
+void nrfInterrupt() {
+    // If the loop is using the nRF right now, this runs as soon as it's done instead.
+    n->submit(handleInterrupt);
+}
 
 unsigned int totalCount = 0;
 void setup() {
@@ -61,7 +66,7 @@ void setup() {
         unsigned char text[32] = "Hello, this is the nRF sending!";
         // Start a sending operation. The operation should finish with our interrupt being called.
         // This method sets the CE pin HIGH, but we need to set it LOW again after the send operation finishes.
-        // The interrupt will be called when the operation is finished, so we call "concludeSendingPacket" inside there.
+        // The interrupt will be called when the operation is finished, so we call "concludeSendingPacket" in the work it submits.
         n->startSendingPacket(text, 32);
         // Wait until "readyForMoreData" is set true inside the interrupt.
         while(readyForMoreData == false);
@@ -0,0 +1,53 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+#include "TDMA.hpp"
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+nRF24L01::TDMAGateway<nRF24L01::ArduinoInterface> *gateway;
+
+unsigned long packetsReceived = 0;
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2 (not used, the gateway is polled from the loop)
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setBitrate(2);
+    n->setAutoAcknowledgementEnabled(true);
+
+    // Each slot is 4ms long. Nodes 1, 2 and 3 get slots 0, 1 and 2.
+    gateway = new nRF24L01::TDMAGateway<nRF24L01::ArduinoInterface>(n, 4000);
+    gateway->assignSlot(0, 1);
+    gateway->assignSlot(1, 2);
+    gateway->assignSlot(2, 3);
+
+    // The nodes send to the first address and listen for beacons on the second one.
+    // Only the first byte differs, so switching between them is a 1 byte write.
+    unsigned char addr[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+    unsigned char beaconAddr[] = {0x13, 0x34, 0x56, 0x78, 0x9A};
+    gateway->begin(addr, beaconAddr, 5);
+}
+
+unsigned long lastPrint = 0;
+void loop() {
+    // Send the beacon when a new frame starts.
+    gateway->poll();
+
+    // Read whatever the nodes sent us.
+    while (n->dataInRXFIFO()) {
+        unsigned char data[32];
+        n->readData(data, 32);
+        packetsReceived++;
+    }
+
+    if (millis() - lastPrint > 1000) {
+        lastPrint = millis();
+        Serial.print("frame: ");
+        Serial.print(gateway->getFrameNumber());
+        Serial.print(" packets received: ");
+        Serial.println(packetsReceived);
+    }
+}
@@ -0,0 +1,42 @@
+
+#include "nRF24L01.hpp"
+#include "ArduinoInterface.hpp"
+#include "TDMA.hpp"
+
+// Must match one of the node IDs the gateway assigned a slot to.
+const unsigned char NODE_ID = 1;
+
+nRF24L01::Controller<nRF24L01::ArduinoInterface> *n;
+nRF24L01::TDMANode<nRF24L01::ArduinoInterface> *node;
+
+void setup() {
+    Serial.begin(9600);
+    // CE pin = 8
+    // Interrupt pin = 2 (not used, the node is polled from the loop)
+    // Chip select pin (for SPI) = 10
+    n = new nRF24L01::Controller<nRF24L01::ArduinoInterface>(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setBitrate(2);
+    n->setAutoAcknowledgementEnabled(true);
+    // Nobody else transmits in our slot, so a couple of retries is plenty.
+    n->setAutoRetransmitCount(2);
+
+    node = new nRF24L01::TDMANode<nRF24L01::ArduinoInterface>(n, NODE_ID);
+    // The gateway's address and the address it sends beacons to.
+    unsigned char addr[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+    unsigned char beaconAddr[] = {0x13, 0x34, 0x56, 0x78, 0x9A};
+    node->begin(addr, beaconAddr, 5);
+}
+
+unsigned long lastReading = 0;
+void loop() {
+    // Keep following the gateway's schedule. The radio is powered down whenever it isn't needed.
+    node->poll();
+
+    // Queue a reading every 100ms, it gets sent in our next slot.
+    if (millis() - lastReading > 100) {
+        lastReading = millis();
+        unsigned char reading[2] = {NODE_ID, (unsigned char)analogRead(A0)};
+        node->send(reading, 2);
+    }
+}
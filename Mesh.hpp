@@ -0,0 +1,417 @@
+//
+//  Mesh.hpp
+//
+//
+//
+
+#ifndef Mesh_hpp
+#define Mesh_hpp
+
+#include "nRF24L01.hpp"
+
+namespace nRF24L01 {
+
+    /**
+     Relays frames between nodes that are more than a single hop apart.
+
+     Every node listens as a primary receiver on its own address, which is the 4 byte network prefix followed by its node ID.
+     To forward a frame the node briefly becomes a primary transmitter, points TX_ADDR/RX_ADDR_P0 at the next hop and switches back afterwards.
+     Routes are learned from the frames passing through the node and from route advertisements (a small distance-vector exchange),
+     and anything without a route goes to the parent (if one is set), so a simple tree only needs `setParent` on every node.
+     When a neighbour doesn't acknowledge a frame, every route through it is forgotten, so the next advertisement or frame can bring in a route around it.
+
+     The mesh owns the radio: don't read or clear the interrupt bits from your own interrupt while using it, call `poll` from your loop instead.
+     */
+    template <class T, unsigned char RouteCount = 8, unsigned char QueueDepth = 4>
+    class MeshNode {
+    public:
+
+        static const unsigned char FRAME_SIZE = 32;
+        static const unsigned char HEADER_SIZE = 6;
+        static const unsigned char MAX_PAYLOAD_SIZE = FRAME_SIZE - HEADER_SIZE;
+        static const unsigned char MAX_HOPS = 8;
+        static const unsigned char NO_NODE = 0xFF;
+
+        /**
+         Called when a frame addressed to this node arrives.
+
+         @param source The node ID of the node that originally sent the frame.
+         @param data The payload. Only valid until the handler returns.
+         @param size The number of bytes in the payload.
+         */
+        typedef void (*DeliveryHandler)(unsigned char source, unsigned char *data, unsigned char size);
+
+        struct Statistics {
+            unsigned long delivered;
+            unsigned long forwarded;
+            unsigned long sent;
+            unsigned long dropped;
+            // Time in microseconds from a frame arriving to it being acknowledged by the next hop.
+            unsigned long lastHopLatency;
+            unsigned long maxHopLatency;
+        };
+
+
+        /**
+         Creates a mesh node on top of an existing controller.
+
+         @param controller The controller of the radio this node uses.
+         @param nodeID The ID of this node, from 0 to 254. Must be unique within the network.
+         @param networkPrefix The 4 address bytes shared by every node in the network.
+         @return An instance of `MeshNode`.
+         */
+        MeshNode(Controller<T> *controller, unsigned char nodeID, const unsigned char networkPrefix[4]): _controller(controller), _nodeID(nodeID), _parentID(NO_NODE), _queueHead(0), _queueCount(0), _deliveryHandler(0) {
+            for(unsigned char i = 0; i < 4; i++) {
+                _networkPrefix[i] = networkPrefix[i];
+            }
+            for(unsigned char i = 0; i < RouteCount; i++) {
+                _routes[i].destination = NO_NODE;
+            }
+            _statistics = Statistics();
+        }
+
+
+        /**
+         Sets up the radio for the mesh: fixed 32 byte frames and listening on this node's address. Call this once after powering up the radio.
+         */
+        void begin() {
+            _controller->setUsesDynamicPayloadLength(false);
+            _controller->setReceivedPacketLength(FRAME_SIZE);
+            _controller->setPrimaryReceiver();
+            listen();
+        }
+
+
+        /**
+         Sets the node that frames without a known route are sent to.
+
+         @param parentID The node ID of the parent, or `NO_NODE` for none (e.g. on the root/gateway).
+         */
+        void setParent(unsigned char parentID) {
+            _parentID = parentID;
+        }
+
+
+        /**
+         Sets the function that gets called with frames addressed to this node.
+
+         @param handler The function to call.
+         */
+        void setDeliveryHandler(DeliveryHandler handler) {
+            _deliveryHandler = handler;
+        }
+
+
+        /**
+         Adds or updates a route. A route is only replaced if the new one is shorter or comes from the same next hop.
+
+         @param destination The node ID that can be reached.
+         @param nextHop The neighbouring node to send frames for `destination` to.
+         @param hops The number of hops to `destination` through `nextHop`.
+         @return `true` if the routing table changed.
+         */
+        bool addRoute(unsigned char destination, unsigned char nextHop, unsigned char hops) {
+            if(destination == _nodeID || destination == NO_NODE || hops > MAX_HOPS) {
+                return false;
+            }
+
+            Route *replace = 0;
+            for(unsigned char i = 0; i < RouteCount; i++) {
+                Route &route = _routes[i];
+                if(route.destination == destination) {
+                    if(route.nextHop == nextHop || hops < route.hops) {
+                        bool changed = route.nextHop != nextHop || route.hops != hops;
+                        route.nextHop = nextHop;
+                        route.hops = hops;
+                        return changed;
+                    }
+                    return false;
+                }
+                // Prefer an empty entry, otherwise evict the longest route if ours is shorter.
+                if(route.destination == NO_NODE) {
+                    if(replace == 0 || replace->destination != NO_NODE) {
+                        replace = &route;
+                    }
+                } else if(hops < route.hops && (replace == 0 || (replace->destination != NO_NODE && route.hops > replace->hops))) {
+                    replace = &route;
+                }
+            }
+
+            if(replace == 0) {
+                return false;
+            }
+            replace->destination = destination;
+            replace->nextHop = nextHop;
+            replace->hops = hops;
+            return true;
+        }
+
+
+        /**
+         Looks up where to send a frame for a node.
+
+         @param destination The node ID the frame is for.
+         @return The neighbouring node ID to transmit to, or `NO_NODE` if there's no route and no parent.
+         */
+        unsigned char getNextHop(unsigned char destination) const {
+            for(unsigned char i = 0; i < RouteCount; i++) {
+                if(_routes[i].destination == destination) {
+                    return _routes[i].nextHop;
+                }
+            }
+            return _parentID;
+        }
+
+
+        /**
+         Queues a frame for another node. The frame is transmitted the next time `poll` is called.
+
+         @param destination The node ID to send to.
+         @param data The data to send.
+         @param size The number of bytes to send, up to `MAX_PAYLOAD_SIZE`.
+         @return `false` if the queue is full or the data is too big.
+         */
+        bool send(unsigned char destination, const unsigned char *data, unsigned char size) {
+            if(size > MAX_PAYLOAD_SIZE) {
+                return false;
+            }
+            unsigned char *frame = reserveFrame();
+            if(frame == 0) {
+                return false;
+            }
+            writeHeader(frame, FrameType::Data, destination, size);
+            for(unsigned char i = 0; i < size; i++) {
+                frame[HEADER_SIZE + i] = data[i];
+            }
+            commitFrame();
+            return true;
+        }
+
+
+        /**
+         Queues a route advertisement for a neighbour, letting it learn every node reachable through this one.
+         Children should advertise to their parent whenever their routing table changes.
+
+         @param neighbourID The node ID of a neighbour within radio range.
+         @return `false` if the queue is full.
+         */
+        bool advertiseRoutes(unsigned char neighbourID) {
+            unsigned char *frame = reserveFrame();
+            if(frame == 0) {
+                return false;
+            }
+            unsigned char size = 0;
+            frame[HEADER_SIZE + size++] = _nodeID;
+            frame[HEADER_SIZE + size++] = 0;
+            for(unsigned char i = 0; i < RouteCount && size + 2 <= MAX_PAYLOAD_SIZE; i++) {
+                // Split horizon: don't tell a neighbour about routes that go through it.
+                if(_routes[i].destination != NO_NODE && _routes[i].nextHop != neighbourID) {
+                    frame[HEADER_SIZE + size++] = _routes[i].destination;
+                    frame[HEADER_SIZE + size++] = _routes[i].hops;
+                }
+            }
+            writeHeader(frame, FrameType::RouteAdvertisement, neighbourID, size);
+            commitFrame();
+            return true;
+        }
+
+
+        /**
+         Reads every frame waiting in the RX FIFO, delivers or forwards them, then transmits everything queued. Call this regularly from your loop.
+         */
+        void poll() {
+            // Read straight into queue slots so forwarded frames are never copied.
+            while(_queueCount < QueueDepth && _controller->dataInRXFIFO()) {
+                unsigned char slot = slotIndex(_queueCount);
+                unsigned char *frame = _queue[slot];
+                _controller->readData(frame, FRAME_SIZE);
+                _arrivalTimes[slot] = _controller->getInterface()->micros();
+                if(acceptFrame(frame)) {
+                    _queueCount++;
+                }
+            }
+
+            if(_queueCount == 0) {
+                return;
+            }
+
+            _controller->concludeSendingPacket();
+            _controller->setPrimaryTransmitter();
+            while(_queueCount > 0) {
+                unsigned char slot = _queueHead;
+                transmitFrame(_queue[slot], _arrivalTimes[slot]);
+                _queueHead = slotIndex(1);
+                _queueCount--;
+            }
+            _controller->setPrimaryReceiver();
+            listen();
+        }
+
+
+        /**
+         @return The delivery, forwarding and latency counters collected since the node was created.
+         */
+        const Statistics &getStatistics() const {
+            return _statistics;
+        }
+
+        unsigned char getNodeID() const {
+            return _nodeID;
+        }
+
+    private:
+
+        enum class FrameType : unsigned char {
+            Data = 1,
+            RouteAdvertisement = 2
+        };
+
+        // Frame header byte offsets
+        enum Header : unsigned char {
+            TYPE = 0,
+            DESTINATION = 1,
+            SOURCE = 2,
+            PREVIOUS_HOP = 3,
+            HOPS = 4,
+            LENGTH = 5
+        };
+
+        struct Route {
+            unsigned char destination;
+            unsigned char nextHop;
+            unsigned char hops;
+        };
+
+        Controller<T> *_controller;
+        unsigned char _nodeID;
+        unsigned char _parentID;
+        unsigned char _networkPrefix[4];
+        Route _routes[RouteCount];
+
+        unsigned char _queue[QueueDepth][FRAME_SIZE];
+        unsigned long _arrivalTimes[QueueDepth];
+        unsigned char _queueHead;
+        unsigned char _queueCount;
+
+        DeliveryHandler _deliveryHandler;
+        Statistics _statistics;
+
+        // How long to wait for the next hop before giving up on a frame.
+        static const unsigned long TRANSMIT_TIMEOUT_MICROSECONDS = 100000;
+
+        unsigned char slotIndex(unsigned char offset) const {
+            return (_queueHead + offset) % QueueDepth;
+        }
+
+        unsigned char *reserveFrame() {
+            if(_queueCount >= QueueDepth) {
+                _statistics.dropped++;
+                return 0;
+            }
+            return _queue[slotIndex(_queueCount)];
+        }
+
+        void commitFrame() {
+            _arrivalTimes[slotIndex(_queueCount)] = _controller->getInterface()->micros();
+            _queueCount++;
+        }
+
+        void writeHeader(unsigned char *frame, FrameType type, unsigned char destination, unsigned char size) {
+            frame[TYPE] = static_cast<unsigned char>(type);
+            frame[DESTINATION] = destination;
+            frame[SOURCE] = _nodeID;
+            frame[PREVIOUS_HOP] = _nodeID;
+            frame[HOPS] = 0;
+            frame[LENGTH] = size;
+        }
+
+        /**
+         Learns routes from a freshly read frame and delivers it if it's for us.
+
+         @return `true` if the frame needs to stay queued to be forwarded.
+         */
+        bool acceptFrame(unsigned char *frame) {
+            unsigned char hops = frame[HOPS] + 1;
+            if(frame[LENGTH] > MAX_PAYLOAD_SIZE || hops > MAX_HOPS) {
+                _statistics.dropped++;
+                return false;
+            }
+
+            addRoute(frame[PREVIOUS_HOP], frame[PREVIOUS_HOP], 1);
+            addRoute(frame[SOURCE], frame[PREVIOUS_HOP], hops);
+
+            if(frame[DESTINATION] != _nodeID) {
+                frame[HOPS] = hops;
+                return true;
+            }
+
+            if(frame[TYPE] == static_cast<unsigned char>(FrameType::RouteAdvertisement)) {
+                for(unsigned char i = 0; i + 1 < frame[LENGTH]; i += 2) {
+                    addRoute(frame[HEADER_SIZE + i], frame[PREVIOUS_HOP], frame[HEADER_SIZE + i + 1] + 1);
+                }
+            } else if(_deliveryHandler != 0) {
+                _deliveryHandler(frame[SOURCE], frame + HEADER_SIZE, frame[LENGTH]);
+            }
+            _statistics.delivered++;
+            return false;
+        }
+
+        /**
+         Sends a queued frame to its next hop. The radio must already be a primary transmitter.
+         */
+        void transmitFrame(unsigned char *frame, unsigned long arrivalTime) {
+            unsigned char nextHop = getNextHop(frame[DESTINATION]);
+            if(nextHop == NO_NODE) {
+                _statistics.dropped++;
+                return;
+            }
+            bool isForward = frame[SOURCE] != _nodeID;
+            frame[PREVIOUS_HOP] = _nodeID;
+
+            setRadioAddress(nextHop);
+            // The frame buffer gets overwritten by the SPI transfer, it's not needed afterwards.
+            if(!_controller->sendPacketAndWait(frame, FRAME_SIZE, false, TRANSMIT_TIMEOUT_MICROSECONDS)) {
+                _statistics.dropped++;
+                forgetRoutesThrough(nextHop);
+                return;
+            }
+
+            T *interface = _controller->getInterface();
+
+            unsigned long latency = interface->micros() - arrivalTime;
+            _statistics.lastHopLatency = latency;
+            if(latency > _statistics.maxHopLatency) {
+                _statistics.maxHopLatency = latency;
+            }
+            if(isForward) {
+                _statistics.forwarded++;
+            } else {
+                _statistics.sent++;
+            }
+        }
+
+        /**
+         Forgets every route through a neighbour. `addRoute` only takes a shorter route or one from the same next hop,
+         so without this a route through a neighbour that went away would never be replaced by one of the same length.
+         */
+        void forgetRoutesThrough(unsigned char nextHop) {
+            for(unsigned char i = 0; i < RouteCount; i++) {
+                if(_routes[i].destination != NO_NODE && _routes[i].nextHop == nextHop) {
+                    _routes[i].destination = NO_NODE;
+                }
+            }
+        }
+
+        void setRadioAddress(unsigned char nodeID) {
+            // The first byte written is the least significant byte, so the node ID goes first.
+            unsigned char address[5] = {nodeID, _networkPrefix[0], _networkPrefix[1], _networkPrefix[2], _networkPrefix[3]};
+            _controller->setAddress(address, 5);
+        }
+
+        void listen() {
+            setRadioAddress(_nodeID);
+        }
+    };
+}
+
+#endif /* Mesh_hpp */
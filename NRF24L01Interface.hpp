@@ -13,9 +13,14 @@ namespace nRF24L01 {
     
     class SpecialPinHolder {
     public:
+        // Pass this as a pin number for pins that aren't connected, e.g. the IRQ pin.
+        static const unsigned char NO_PIN = 0xFF;
+
         virtual unsigned char getIRQPin() const = 0;
         virtual unsigned char getCSNPin() const = 0;
         virtual unsigned char getCEPin() const = 0;
+
+        virtual ~SpecialPinHolder() {}
     };
     
     
@@ -32,17 +37,27 @@ namespace nRF24L01 {
         
         virtual void delay(unsigned int d) = 0;
         virtual void delayMicroseconds(unsigned int d) = 0;
+        virtual unsigned long micros() = 0;
         
         virtual void writeCSNHigh() = 0;
         virtual void writeCSNLow() = 0;
         virtual void writeCEHigh() = 0;
         virtual void writeCELow() = 0;
         
+        // SPI bus ownership. Locks must nest for the same owner (thread or main loop), and tryLockBus must never block so it can be called from interrupts.
+        virtual bool tryLockBus() = 0;
+        virtual void lockBus() = 0;
+        virtual void unlockBus() = 0;
+        // Short sections that neither interrupts nor other threads can run in the middle of.
+        virtual void enterCritical() = 0;
+        virtual void exitCritical() = 0;
+        
         NRF24L01Interface(SpecialPinHolder *s) {
             _IRQPin = s->getIRQPin();
             _CSNPin = s->getCSNPin();
             _CEPin = s->getCEPin();
         }
+        virtual ~NRF24L01Interface() {}
     protected:
         unsigned char _IRQPin;
         unsigned char _CSNPin;
@@ -0,0 +1,221 @@
+//
+//  PeerTable.hpp
+//
+//
+//
+
+#ifndef PeerTable_hpp
+#define PeerTable_hpp
+
+#include "nRF24L01.hpp"
+
+namespace nRF24L01 {
+
+    /**
+     Sends to many receivers from one primary transmitter. Each receiver's address is stored once under a peer ID,
+     and the nRF is only reprogrammed when the destination actually changes (see `Controller::setAddress`).
+     Queued packets are sent grouped by destination, so a round of packets to many peers needs as few address switches as possible.
+     */
+    template <class T, unsigned char PeerCount = 16, unsigned char QueueDepth = 8>
+    class PeerTable {
+    public:
+
+        static const unsigned char NO_PEER = 0xFF;
+
+        struct Statistics {
+            unsigned long packetsSent;
+            unsigned long packetsFailed;
+            // Times the nRF had to be pointed at a different peer, i.e. `setAddress` had to write something
+            unsigned long addressSwitches;
+        };
+
+
+        /**
+         @param controller The controller of a radio that's set up as a primary transmitter.
+         @return An instance of `PeerTable`.
+         */
+        PeerTable(Controller<T> *controller): _controller(controller), _currentPeer(NO_PEER), _queueCount(0) {
+            for(unsigned char i = 0; i < PeerCount; i++) {
+                _peers[i].addressSize = 0;
+            }
+            _statistics = Statistics();
+        }
+
+
+        /**
+         Stores the address of a peer.
+
+         @param peerID A number from 0 to `PeerCount - 1` to refer to the peer by.
+         @param address 3-5 bytes
+         @param addressSize The number of bytes in the address
+         @return `false` if the peer ID is out of range.
+         */
+        bool setPeer(unsigned char peerID, const unsigned char address[], unsigned char addressSize) {
+            if(peerID >= PeerCount || addressSize < 3 || addressSize > 5) {
+                return false;
+            }
+            Peer &peer = _peers[peerID];
+            for(unsigned char i = 0; i < addressSize; i++) {
+                peer.address[i] = address[i];
+            }
+            peer.addressSize = addressSize;
+            if(_currentPeer == peerID) {
+                // The nRF still has the old address
+                _currentPeer = NO_PEER;
+            }
+            return true;
+        }
+
+
+        /**
+         ***MUST BE PAIRED WITH A CALL TO `concludeSendingPacket`***
+         Starts sending a packet to a peer, just like `startSendingPacket`.
+
+         @param peerID The peer to send to.
+         @param data The data to send.
+         @param size The number of bytes to send.
+         @param noACK Requires dynamic ACK to be enabled. If enabled, setting this parameter to true will disable ACK for this single packet.
+         @return `false` if the peer doesn't exist.
+         */
+        bool sendTo(unsigned char peerID, unsigned char *data, unsigned char size, bool noACK = false) {
+            if(!selectPeer(peerID)) {
+                return false;
+            }
+            _controller->startSendingPacket(data, size, noACK);
+            return true;
+        }
+
+
+        /**
+         Queues a packet for a peer. Nothing is sent until `flush` is called.
+
+         @param peerID The peer to send to.
+         @param data The data to send.
+         @param size The number of bytes to send, up to 32.
+         @param noACK Requires dynamic ACK to be enabled. If enabled, setting this parameter to true will disable ACK for this single packet.
+         @return `false` if the queue is full, the peer doesn't exist or the data is too big.
+         */
+        bool queue(unsigned char peerID, const unsigned char *data, unsigned char size, bool noACK = false) {
+            if(_queueCount >= QueueDepth || peerID >= PeerCount || _peers[peerID].addressSize == 0 || size > 32) {
+                return false;
+            }
+            QueuedPacket &packet = _queue[_queueCount++];
+            packet.peerID = peerID;
+            packet.size = size;
+            packet.noACK = noACK;
+            for(unsigned char i = 0; i < size; i++) {
+                packet.data[i] = data[i];
+            }
+            return true;
+        }
+
+
+        /**
+         Sends every queued packet and waits for each one to finish. Packets for the peer the nRF is already pointed at go first,
+         then all the packets for the peer of the oldest remaining packet, and so on. Packets for the same peer stay in order.
+         Don't read or clear the interrupt bits from your own interrupt while this runs.
+
+         @return The number of packets that were sent successfully.
+         */
+        unsigned char flush() {
+            unsigned char sent = 0;
+            while(_queueCount > 0) {
+                if(_currentPeer == NO_PEER || !hasQueuedPacketFor(_currentPeer)) {
+                    _currentPeer = _queue[0].peerID;
+                }
+                // Even when staying with the same peer, someone may have called setAddress since.
+                selectPeer(_currentPeer);
+
+                // Send everything for the current peer, compacting the rest of the queue as we go.
+                unsigned char remaining = 0;
+                for(unsigned char i = 0; i < _queueCount; i++) {
+                    QueuedPacket &packet = _queue[i];
+                    if(packet.peerID != _currentPeer) {
+                        if(remaining != i) {
+                            _queue[remaining] = packet;
+                        }
+                        remaining++;
+                        continue;
+                    }
+                    if(transmit(packet)) {
+                        sent++;
+                    }
+                }
+                _queueCount = remaining;
+            }
+            return sent;
+        }
+
+
+        unsigned char getQueuedCount() const {
+            return _queueCount;
+        }
+
+        const Statistics &getStatistics() const {
+            return _statistics;
+        }
+
+    private:
+
+        struct Peer {
+            unsigned char address[5];
+            // 0 for an unused entry
+            unsigned char addressSize;
+        };
+
+        struct QueuedPacket {
+            unsigned char peerID;
+            unsigned char size;
+            bool noACK;
+            unsigned char data[32];
+        };
+
+        // How long to wait for a single send before giving up on it.
+        static const unsigned long TRANSMIT_TIMEOUT_MICROSECONDS = 100000;
+
+        Controller<T> *_controller;
+        Peer _peers[PeerCount];
+        unsigned char _currentPeer;
+        QueuedPacket _queue[QueueDepth];
+        unsigned char _queueCount;
+        Statistics _statistics;
+
+        /**
+         Points the nRF at a peer. Always goes through `setAddress`, which knows what the nRF really has
+         (even after someone else changed the address) and costs nothing when the address is already there.
+         */
+        bool selectPeer(unsigned char peerID) {
+            if(peerID >= PeerCount || _peers[peerID].addressSize == 0) {
+                return false;
+            }
+            if(_controller->setAddress(_peers[peerID].address, _peers[peerID].addressSize)) {
+                _statistics.addressSwitches++;
+            }
+            _currentPeer = peerID;
+            return true;
+        }
+
+        bool hasQueuedPacketFor(unsigned char peerID) const {
+            for(unsigned char i = 0; i < _queueCount; i++) {
+                if(_queue[i].peerID == peerID) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         Sends a packet to the current peer and waits for it to finish. The packet's data is overwritten by the SPI transfer.
+         */
+        bool transmit(QueuedPacket &packet) {
+            if(!_controller->sendPacketAndWait(packet.data, packet.size, packet.noACK, TRANSMIT_TIMEOUT_MICROSECONDS)) {
+                _statistics.packetsFailed++;
+                return false;
+            }
+            _statistics.packetsSent++;
+            return true;
+        }
+    };
+}
+
+#endif /* PeerTable_hpp */
@@ -0,0 +1,342 @@
+//
+//  PrioritySender.hpp
+//
+//
+//
+
+#ifndef PrioritySender_hpp
+#define PrioritySender_hpp
+
+#include "nRF24L01.hpp"
+
+namespace nRF24L01 {
+
+    /**
+     Queues outgoing packets by priority in front of a primary transmitter. Control packets always go first, and queueing
+     one pushes any normal or bulk packets that haven't been sent yet out of the nRF's TX FIFO (`FLUSH_TX`) and back into their queues,
+     so a control packet never waits behind more than the packet already on the air. Normal and bulk packets share what's left in a weighted round robin.
+     Packets of the same priority are always sent in the order they were queued.
+     */
+    template <class T, unsigned char QueueDepth = 4>
+    class PrioritySender {
+    public:
+
+        enum class Priority : unsigned char {
+            Control = 0,
+            Normal = 1,
+            Bulk = 2
+        };
+
+        static const unsigned char PRIORITY_COUNT = 3;
+
+        struct Statistics {
+            unsigned long packetsSent[PRIORITY_COUNT];
+            unsigned long packetsFailed[PRIORITY_COUNT];
+            // Times a control packet pushed other packets out of the TX FIFO
+            unsigned long preemptions;
+            // Microseconds from queueing a control packet to noticing it was sent
+            unsigned long lastControlLatency;
+            unsigned long maxControlLatency;
+        };
+
+
+        /**
+         @param controller The controller of a radio that's set up as a primary transmitter.
+         @return An instance of `PrioritySender`.
+         */
+        PrioritySender(Controller<T> *controller): _controller(controller), _inFlightCount(0) {
+            for(unsigned char i = 0; i < PRIORITY_COUNT; i++) {
+                _queues[i].head = 0;
+                _queues[i].count = 0;
+                _weights[i] = 1;
+                _credits[i] = 0;
+            }
+            _weights[(unsigned char)Priority::Normal] = 4;
+            _statistics = Statistics();
+        }
+
+
+        /**
+         Sets how many normal or bulk packets are sent in a row before the other priority gets its turn.
+         Control packets don't have a weight, they always go first.
+
+         @param priority `Normal` or `Bulk`.
+         @param weight At least 1. By default normal packets have a weight of 4 and bulk packets a weight of 1.
+         @return `false` for `Control` or a weight of 0.
+         */
+        bool setWeight(Priority priority, unsigned char weight) {
+            if(priority == Priority::Control || weight == 0) {
+                return false;
+            }
+            _weights[(unsigned char)priority] = weight;
+            return true;
+        }
+
+
+        /**
+         Queues a packet and starts sending it right away if the nRF has room for it.
+         A control packet first waits for the packet on the air to finish, then flushes the normal and bulk packets behind it
+         from the TX FIFO. They're queued again in front of their priority, so nothing is lost or sent twice.
+
+         @param priority The queue to add the packet to.
+         @param data The data to send.
+         @param size The number of bytes to send, up to 32.
+         @param noACK Requires dynamic ACK to be enabled. If enabled, setting this parameter to true will disable ACK for this single packet.
+         @return `false` if the queue is full or the data is too big.
+         */
+        bool queue(Priority priority, const unsigned char *data, unsigned char size, bool noACK = false) {
+            unsigned char p = (unsigned char)priority;
+            // Packets in the TX FIFO keep their place in the queue, so there's always room to put them back.
+            if(size > 32 || _queues[p].count + inFlightCountFor(priority) >= QueueDepth) {
+                return false;
+            }
+
+            Queue &q = _queues[p];
+            Packet &packet = q.packets[(q.head + q.count) % QueueDepth];
+            q.count++;
+            packet.priority = priority;
+            packet.size = size;
+            packet.noACK = noACK;
+            packet.queuedAt = _controller->getInterface()->micros();
+            for(unsigned char i = 0; i < size; i++) {
+                packet.data[i] = data[i];
+            }
+
+            if(priority == Priority::Control && needsPreemption()) {
+                preempt();
+            }
+            fill();
+            return true;
+        }
+
+
+        /**
+         Checks which packets have been sent and tops up the TX FIFO. Call this from your loop, or from your IRQ interrupt
+         through `submit`. Don't read or clear the interrupt bits anywhere else while packets are queued.
+         */
+        void service() {
+            if(_inFlightCount > 0) {
+                update();
+            }
+            fill();
+        }
+
+
+        /**
+         @return The number of packets waiting in the queue, not counting the ones in the nRF's TX FIFO.
+         */
+        unsigned char getQueuedCount(Priority priority) const {
+            return _queues[(unsigned char)priority].count;
+        }
+
+        /**
+         @return `true` once every queued packet has been sent (or given up on.)
+         */
+        bool isIdle() const {
+            return _inFlightCount == 0 && _queues[0].count == 0 && _queues[1].count == 0 && _queues[2].count == 0;
+        }
+
+        const Statistics &getStatistics() const {
+            return _statistics;
+        }
+
+    private:
+
+        struct Packet {
+            Priority priority;
+            unsigned char size;
+            bool noACK;
+            unsigned long queuedAt;
+            unsigned char data[32];
+        };
+
+        struct Queue {
+            Packet packets[QueueDepth];
+            unsigned char head;
+            unsigned char count;
+        };
+
+        // How many packets are kept in the nRF's TX FIFO. The FIFO holds 3, but with 2 the FIFO_STATUS register
+        // and the TX_DS bit together tell exactly how many were sent, and 2 are enough to keep the nRF sending back to back.
+        static const unsigned char MAX_IN_FLIGHT = 2;
+
+        // How long a preemption waits at most for the packet on the air, longer than a packet with 15 retransmits 4ms apart takes.
+        static const unsigned long PREEMPT_TIMEOUT_MICROSECONDS = 100000;
+
+        Controller<T> *_controller;
+        Queue _queues[PRIORITY_COUNT];
+        unsigned char _weights[PRIORITY_COUNT];
+        unsigned char _credits[PRIORITY_COUNT];
+        // Copies of the packets in the TX FIFO, oldest first
+        Packet _inFlight[MAX_IN_FLIGHT];
+        unsigned char _inFlightCount;
+        Statistics _statistics;
+
+        unsigned char inFlightCountFor(Priority priority) const {
+            unsigned char count = 0;
+            for(unsigned char i = 0; i < _inFlightCount; i++) {
+                if(_inFlight[i].priority == priority) {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        bool needsPreemption() const {
+            // The front packet is on the air and always finishes, only the ones behind it can be taken out.
+            for(unsigned char i = 1; i < _inFlightCount; i++) {
+                if(_inFlight[i].priority != Priority::Control) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         Works out how many packets in the TX FIFO were sent since the last call. The FIFO is read before the interrupt bits,
+         so a packet that finishes in between is never counted too early, only on the next call.
+         */
+        void update() {
+            bool pending = _controller->dataInTXFIFO();
+            _controller->readAndClearInterruptBits();
+
+            if(_controller->didHitMaxRetry()) {
+                // The nRF stops at the failed packet, so TX_DS can only be from the packet in front of it.
+                unsigned char sent = (_inFlightCount == 2 && _controller->didSendPayload()) ? 1 : 0;
+                retire(sent);
+                _statistics.packetsFailed[(unsigned char)_inFlight[0].priority]++;
+                shiftInFlight(1);
+                // The failed packet is still at the front of the TX FIFO. Take everything out and let fill upload the rest again.
+                _controller->flushTXFIFO();
+                requeueInFlight();
+                return;
+            }
+
+            if(!pending) {
+                retire(_inFlightCount);
+            } else if(_controller->didSendPayload()) {
+                retire(1);
+            }
+        }
+
+        /**
+         Counts the oldest packets in the TX FIFO as sent.
+         */
+        void retire(unsigned char count) {
+            unsigned long now = _controller->getInterface()->micros();
+            for(unsigned char i = 0; i < count; i++) {
+                Packet &packet = _inFlight[i];
+                _statistics.packetsSent[(unsigned char)packet.priority]++;
+                if(packet.priority == Priority::Control) {
+                    _statistics.lastControlLatency = now - packet.queuedAt;
+                    if(_statistics.lastControlLatency > _statistics.maxControlLatency) {
+                        _statistics.maxControlLatency = _statistics.lastControlLatency;
+                    }
+                }
+            }
+            shiftInFlight(count);
+        }
+
+        void shiftInFlight(unsigned char count) {
+            for(unsigned char i = count; i < _inFlightCount; i++) {
+                _inFlight[i - count] = _inFlight[i];
+            }
+            _inFlightCount -= count;
+        }
+
+        /**
+         Puts the packets that were in the TX FIFO back at the front of their queues, in their original order.
+         */
+        void requeueInFlight() {
+            while(_inFlightCount > 0) {
+                Packet &packet = _inFlight[--_inFlightCount];
+                Queue &q = _queues[(unsigned char)packet.priority];
+                q.head = (q.head + QueueDepth - 1) % QueueDepth;
+                q.packets[q.head] = packet;
+                q.count++;
+            }
+        }
+
+        /**
+         Takes the packets behind the one on the air out of the TX FIFO so a control packet can go next. With CE low the nRF
+         finishes the packet it's sending, including its retransmits, but doesn't start the next one. Flushing before it finishes
+         could deliver it and queue it again, so it would arrive twice.
+         */
+        void preempt() {
+            unsigned char inFlight = _inFlightCount;
+            _controller->concludeSendingPacket();
+            update();
+            if(_inFlightCount != inFlight) {
+                // The front packet finished around the time CE went low, so the next one may or may not have started.
+                // Leave it in the TX FIFO, the control packet goes right after it.
+                return;
+            }
+
+            // Nothing finished since CE went low, so the front packet is still being sent. Wait for it to be sent or given up on.
+            unsigned long start = _controller->getInterface()->micros();
+            while(_inFlightCount == inFlight && _controller->getInterface()->micros() - start <= PREEMPT_TIMEOUT_MICROSECONDS) {
+                update();
+            }
+            if(_inFlightCount == 0) {
+                return;
+            }
+            // What's left never started.
+            _controller->flushTXFIFO();
+            requeueInFlight();
+            _statistics.preemptions++;
+        }
+
+        /**
+         @return The queue to send from next, or `PRIORITY_COUNT` if everything is empty.
+         */
+        unsigned char nextQueue() {
+            if(_queues[(unsigned char)Priority::Control].count > 0) {
+                return (unsigned char)Priority::Control;
+            }
+            for(unsigned char pass = 0; pass < 2; pass++) {
+                for(unsigned char p = (unsigned char)Priority::Normal; p < PRIORITY_COUNT; p++) {
+                    if(_queues[p].count > 0 && _credits[p] > 0) {
+                        _credits[p]--;
+                        return p;
+                    }
+                }
+                // Everyone with packets used up their turn, start a new round.
+                for(unsigned char p = 0; p < PRIORITY_COUNT; p++) {
+                    _credits[p] = _weights[p];
+                }
+            }
+            return PRIORITY_COUNT;
+        }
+
+        /**
+         Uploads queued packets until the TX FIFO holds `MAX_IN_FLIGHT` of them.
+         */
+        void fill() {
+            while(_inFlightCount < MAX_IN_FLIGHT) {
+                unsigned char p = nextQueue();
+                if(p == PRIORITY_COUNT) {
+                    break;
+                }
+                Queue &q = _queues[p];
+                Packet &packet = _inFlight[_inFlightCount++];
+                packet = q.packets[q.head];
+                q.head = (q.head + 1) % QueueDepth;
+                q.count--;
+
+                // The SPI transfer overwrites the data, and the copy in _inFlight is needed if the packet has to be sent again.
+                unsigned char data[32];
+                for(unsigned char i = 0; i < packet.size; i++) {
+                    data[i] = packet.data[i];
+                }
+                // CE stays high, so the nRF sends each packet as soon as it's uploaded.
+                _controller->startSendingPacket(data, packet.size, packet.noACK);
+            }
+            if(_inFlightCount == 0) {
+                // Nothing left to send, go back to standby.
+                _controller->concludeSendingPacket();
+            }
+        }
+    };
+}
+
+#endif /* PrioritySender_hpp */
@@ -0,0 +1,472 @@
+//
+//  TDMA.hpp
+//
+//
+//
+
+#ifndef TDMA_hpp
+#define TDMA_hpp
+
+#include "nRF24L01.hpp"
+
+namespace nRF24L01 {
+
+    /**
+     Layout of the beacon the gateway broadcasts at the start of every TDMA frame.
+     */
+    struct TDMABeacon {
+        static const unsigned char SIZE = 32;
+        static const unsigned char MARKER = 0xB5;
+        static const unsigned char NO_NODE = 0xFF;
+
+        // Byte offsets
+        enum Field : unsigned char {
+            FIELD_MARKER = 0,
+            // Frame number, least significant byte first
+            FIELD_FRAME_NUMBER = 1,
+            FIELD_SLOT_COUNT = 3,
+            // Slot length in microseconds, least significant byte first
+            FIELD_SLOT_LENGTH = 4,
+            // One node ID per slot
+            FIELD_SLOT_MAP = 6
+        };
+
+        static const unsigned char MAX_SLOTS = SIZE - FIELD_SLOT_MAP;
+
+        /**
+         @return `true` if `now` is at or past `time`, taking the timer wrapping around into account.
+         */
+        static bool reached(unsigned long now, unsigned long time) {
+            return (long)(now - time) >= 0;
+        }
+    };
+
+
+    /**
+     The receiving side of a TDMA network. Every frame starts with a beacon (sent without ACK) in slot 0,
+     followed by one slot per transmitting node. The beacon carries the frame number and the slot map,
+     so the nodes only ever transmit inside their own slot and never collide with each other.
+
+     Nodes send to the address the gateway listens on, and the gateway sends its beacons to a separate beacon address.
+     Nodes only listen on the beacon address, so they never acknowledge each other's packets (which would collide with the gateway's ACK.)
+     Read their packets with `dataInRXFIFO` and `readData` as usual. Packets are always `TDMABeacon::SIZE` bytes.
+     */
+    template <class T, unsigned char MaxSlots = 16>
+    class TDMAGateway {
+        static_assert(MaxSlots <= TDMABeacon::MAX_SLOTS, "The slot map must fit in a single beacon");
+
+    public:
+
+        /**
+         @param controller The controller of the gateway's radio.
+         @param slotMicroseconds The length of each slot. It has to fit at least one packet plus its ACK and retries, and twice the nodes' guard time.
+         @return An instance of `TDMAGateway`.
+         */
+        TDMAGateway(Controller<T> *controller, unsigned int slotMicroseconds): _controller(controller), _slotMicroseconds(slotMicroseconds), _slotCount(0), _frameNumber(0), _frameStart(0), _started(false), _addressSize(0) {
+            for(unsigned char i = 0; i < MaxSlots; i++) {
+                _slotMap[i] = TDMABeacon::NO_NODE;
+            }
+        }
+
+
+        /**
+         Sets up the radio and starts listening. Call this once after powering up the radio.
+
+         @param address The address the gateway listens on and the nodes send to.
+         @param beaconAddress The address beacons are sent to. Must differ from `address`, ideally only in the first byte, which is the cheapest to switch.
+         @param addressSize The number of bytes in each address.
+         */
+        void begin(unsigned char address[], unsigned char beaconAddress[], unsigned char addressSize) {
+            _addressSize = addressSize;
+            for(unsigned char i = 0; i < addressSize; i++) {
+                _address[i] = address[i];
+                _beaconAddress[i] = beaconAddress[i];
+            }
+            _controller->setUsesDynamicPayloadLength(false);
+            _controller->setDynamicACKEnabled(true);
+            _controller->setReceivedPacketLength(TDMABeacon::SIZE);
+            _controller->setPrimaryTransmitter();
+            _controller->setAddress(_address, _addressSize);
+            _controller->setPrimaryReceiver();
+        }
+
+
+        /**
+         Gives a node a slot. Slots are numbered from 0, and the number of slots per frame grows to include the highest assigned slot.
+
+         @param slot The slot number.
+         @param nodeID The node that may transmit in the slot, or `TDMABeacon::NO_NODE` to free it.
+         @return `false` if the slot doesn't exist.
+         */
+        bool assignSlot(unsigned char slot, unsigned char nodeID) {
+            if(slot >= MaxSlots) {
+                return false;
+            }
+            _slotMap[slot] = nodeID;
+            if(nodeID != TDMABeacon::NO_NODE && slot >= _slotCount) {
+                _slotCount = slot + 1;
+            }
+            return true;
+        }
+
+
+        /**
+         @return The length of a whole frame (the beacon slot plus every node slot) in microseconds.
+         */
+        unsigned long getFramePeriod() const {
+            return (unsigned long)(_slotCount + 1) * _slotMicroseconds;
+        }
+
+        unsigned int getFrameNumber() const {
+            return _frameNumber;
+        }
+
+
+        /**
+         Sends the beacon when the next frame is due. Call this regularly from your loop.
+         */
+        void poll() {
+            unsigned long now = _controller->getInterface()->micros();
+            if(_started && !TDMABeacon::reached(now, _frameStart + getFramePeriod())) {
+                return;
+            }
+            // Keep the frames back to back instead of drifting by however late poll was called.
+            _frameStart = _started ? _frameStart + getFramePeriod() : now;
+            _started = true;
+            _frameNumber++;
+
+            unsigned char beacon[TDMABeacon::SIZE];
+            beacon[TDMABeacon::FIELD_MARKER] = TDMABeacon::MARKER;
+            beacon[TDMABeacon::FIELD_FRAME_NUMBER] = _frameNumber & 0xFF;
+            beacon[TDMABeacon::FIELD_FRAME_NUMBER + 1] = _frameNumber >> 8;
+            beacon[TDMABeacon::FIELD_SLOT_COUNT] = _slotCount;
+            beacon[TDMABeacon::FIELD_SLOT_LENGTH] = _slotMicroseconds & 0xFF;
+            beacon[TDMABeacon::FIELD_SLOT_LENGTH + 1] = _slotMicroseconds >> 8;
+            for(unsigned char i = 0; i < TDMABeacon::MAX_SLOTS; i++) {
+                beacon[TDMABeacon::FIELD_SLOT_MAP + i] = i < _slotCount ? _slotMap[i] : TDMABeacon::NO_NODE;
+            }
+
+            _controller->concludeSendingPacket();
+            _controller->setPrimaryTransmitter();
+            _controller->setAddress(_beaconAddress, _addressSize);
+            // Without an ACK this only takes the time on air.
+            _controller->sendPacketAndWait(beacon, TDMABeacon::SIZE, true, _slotMicroseconds);
+            _controller->setAddress(_address, _addressSize);
+            _controller->setPrimaryReceiver();
+        }
+
+    private:
+        Controller<T> *_controller;
+        unsigned int _slotMicroseconds;
+        unsigned char _slotMap[MaxSlots];
+        unsigned char _slotCount;
+        unsigned int _frameNumber;
+        unsigned long _frameStart;
+        bool _started;
+        unsigned char _address[5];
+        unsigned char _beaconAddress[5];
+        unsigned char _addressSize;
+    };
+
+
+    /**
+     A transmitter in a TDMA network. The node listens for the gateway's beacon, then only transmits inside its own slot,
+     timing it with the local clock. The difference between the beacon interval it measures and the one announced by the gateway
+     is used to correct for clock drift. Outside of its slot and the beacon listen window the radio is powered down.
+
+     Packets queued with `send` are padded to `TDMABeacon::SIZE` bytes.
+     */
+    template <class T, unsigned char QueueDepth = 4>
+    class TDMANode {
+    public:
+
+        struct Statistics {
+            unsigned long beaconsReceived;
+            unsigned long beaconsMissed;
+            unsigned long packetsSent;
+            unsigned long packetsFailed;
+            // How much longer (or shorter, when negative) our clock measures a frame than the gateway announces.
+            long driftMicroseconds;
+        };
+
+
+        /**
+         @param controller The controller of the node's radio.
+         @param nodeID The node ID the gateway uses in its slot map.
+         @param guardMicroseconds How much earlier than expected to start listening for the beacon, and how far into/before the end of the slot to stay quiet.
+         @return An instance of `TDMANode`.
+         */
+        TDMANode(Controller<T> *controller, unsigned char nodeID, unsigned int guardMicroseconds = 500): _controller(controller), _nodeID(nodeID), _guardMicroseconds(guardMicroseconds), _state(State::Searching), _slot(TDMABeacon::NO_NODE), _frameNumber(0), _lastBeacon(0), _lastBeaconFrame(0), _nominalPeriod(0), _slotMicroseconds(0), _sentThisFrame(false), _missedInARow(0), _queueHead(0), _queueCount(0), _packetMicroseconds(0), _addressSize(0) {
+            _statistics = Statistics();
+        }
+
+
+        /**
+         Sets up the radio and starts searching for the gateway's beacon. Call this once after powering up the radio.
+
+         @param address The gateway's address.
+         @param beaconAddress The address the gateway sends its beacons to.
+         @param addressSize The number of bytes in each address.
+         */
+        void begin(unsigned char address[], unsigned char beaconAddress[], unsigned char addressSize) {
+            _addressSize = addressSize;
+            for(unsigned char i = 0; i < addressSize; i++) {
+                _address[i] = address[i];
+                _beaconAddress[i] = beaconAddress[i];
+            }
+            _controller->setUsesDynamicPayloadLength(false);
+            _controller->setDynamicACKEnabled(true);
+            _controller->setReceivedPacketLength(TDMABeacon::SIZE);
+            _state = State::Searching;
+            listen();
+        }
+
+
+        /**
+         Queues a packet to be sent in this node's next slot.
+
+         @param data The data to send.
+         @param size The number of bytes to send, up to `TDMABeacon::SIZE`.
+         @return `false` if the queue is full or the data is too big.
+         */
+        bool send(const unsigned char *data, unsigned char size) {
+            if(_queueCount >= QueueDepth || size > TDMABeacon::SIZE) {
+                return false;
+            }
+            unsigned char *packet = _queue[(_queueHead + _queueCount) % QueueDepth];
+            for(unsigned char i = 0; i < TDMABeacon::SIZE; i++) {
+                packet[i] = i < size ? data[i] : 0;
+            }
+            _queueCount++;
+            return true;
+        }
+
+
+        /**
+         Runs the schedule: listens for beacons, wakes up for this node's slot and sends queued packets. Call this as often as possible from your loop.
+         */
+        void poll() {
+            unsigned long now = _controller->getInterface()->micros();
+            switch(_state) {
+                case State::Searching:
+                case State::Listening: {
+                    if(receiveBeacon()) {
+                        sleep();
+                    } else if(_state == State::Listening && TDMABeacon::reached(now, _nextBeacon + _guardMicroseconds)) {
+                        // Missed the beacon. Carry on with the predicted timing for a few frames.
+                        _statistics.beaconsMissed++;
+                        if(++_missedInARow >= MAX_MISSED_BEACONS) {
+                            _state = State::Searching;
+                        } else {
+                            startFrame(_nextBeacon, _frameNumber + 1);
+                            sleep();
+                        }
+                    }
+                    break;
+                }
+                case State::Sleeping: {
+                    if(!_sentThisFrame && _slot != TDMABeacon::NO_NODE && _queueCount > 0 && TDMABeacon::reached(now, _slotStart - POWER_UP_MICROSECONDS)) {
+                        transmitInSlot();
+                        // The last slot ends right before the beacon, too late to power down and back up again.
+                        if(!TDMABeacon::reached(_controller->getInterface()->micros(), _nextBeacon - _guardMicroseconds - POWER_UP_MICROSECONDS)) {
+                            sleep();
+                        }
+                    }
+                    if(TDMABeacon::reached(_controller->getInterface()->micros(), _nextBeacon - _guardMicroseconds - POWER_UP_MICROSECONDS)) {
+                        listen();
+                        _state = State::Listening;
+                    }
+                    break;
+                }
+            }
+        }
+
+
+        /**
+         @return `true` once a beacon has been received and this node is following the gateway's schedule.
+         */
+        bool isSynchronized() const {
+            return _state != State::Searching;
+        }
+
+        const Statistics &getStatistics() const {
+            return _statistics;
+        }
+
+    private:
+
+        enum class State : unsigned char {
+            // Listening continuously until a beacon arrives
+            Searching,
+            // Radio powered down between windows
+            Sleeping,
+            // Listening for the next expected beacon
+            Listening
+        };
+
+        // setPoweredUp waits this long for the oscillator to start.
+        static const unsigned long POWER_UP_MICROSECONDS = 2000;
+        static const unsigned char MAX_MISSED_BEACONS = 4;
+
+        Controller<T> *_controller;
+        unsigned char _nodeID;
+        unsigned int _guardMicroseconds;
+        State _state;
+
+        // Schedule, all in local microseconds
+        unsigned char _slot;
+        unsigned int _frameNumber;
+        unsigned long _frameStart;
+        // Local time and frame number of the last beacon actually received
+        unsigned long _lastBeacon;
+        unsigned int _lastBeaconFrame;
+        unsigned long _nextBeacon;
+        unsigned long _slotStart;
+        unsigned long _slotEnd;
+        unsigned long _nominalPeriod;
+        unsigned int _slotMicroseconds;
+        bool _sentThisFrame;
+        unsigned char _missedInARow;
+
+        unsigned char _queue[QueueDepth][TDMABeacon::SIZE];
+        unsigned char _queueHead;
+        unsigned char _queueCount;
+        // How long a successful send takes, so we don't start one that overruns the slot. Follows a longer send right away
+        // and a shorter one slowly, so a run of retransmits doesn't keep the slot short for good.
+        unsigned long _packetMicroseconds;
+
+        unsigned char _address[5];
+        unsigned char _beaconAddress[5];
+        unsigned char _addressSize;
+
+        Statistics _statistics;
+
+        /**
+         Reads everything in the RX FIFO looking for a beacon, and synchronizes to it.
+
+         @return `true` if a beacon was found.
+         */
+        bool receiveBeacon() {
+            bool found = false;
+            while(_controller->dataInRXFIFO()) {
+                unsigned long now = _controller->getInterface()->micros();
+                unsigned char beacon[TDMABeacon::SIZE];
+                _controller->readData(beacon, TDMABeacon::SIZE);
+                if(beacon[TDMABeacon::FIELD_MARKER] != TDMABeacon::MARKER) {
+                    continue;
+                }
+
+                unsigned int frameNumber = beacon[TDMABeacon::FIELD_FRAME_NUMBER] | (beacon[TDMABeacon::FIELD_FRAME_NUMBER + 1] << 8);
+                unsigned char slotCount = beacon[TDMABeacon::FIELD_SLOT_COUNT];
+                _slotMicroseconds = beacon[TDMABeacon::FIELD_SLOT_LENGTH] | (beacon[TDMABeacon::FIELD_SLOT_LENGTH + 1] << 8);
+                _nominalPeriod = (unsigned long)(slotCount + 1) * _slotMicroseconds;
+
+                _slot = TDMABeacon::NO_NODE;
+                for(unsigned char i = 0; i < slotCount && i < TDMABeacon::MAX_SLOTS; i++) {
+                    if(beacon[TDMABeacon::FIELD_SLOT_MAP + i] == _nodeID) {
+                        _slot = i;
+                        break;
+                    }
+                }
+
+                // Drift correction: compare the measured beacon interval with the announced one and smooth the difference.
+                unsigned int frames = frameNumber - _lastBeaconFrame;
+                if(_state != State::Searching && frames > 0 && frames <= MAX_MISSED_BEACONS) {
+                    long measured = (long)((now - _lastBeacon) / frames);
+                    long error = measured - (long)_nominalPeriod;
+                    _statistics.driftMicroseconds += (error - _statistics.driftMicroseconds) / 4;
+                }
+                _lastBeacon = now;
+                _lastBeaconFrame = frameNumber;
+                _missedInARow = 0;
+                _statistics.beaconsReceived++;
+                startFrame(now, frameNumber);
+                found = true;
+            }
+            return found;
+        }
+
+        /**
+         Works out this frame's slot and the next beacon from the frame's start time.
+         */
+        void startFrame(unsigned long frameStart, unsigned int frameNumber) {
+            _frameStart = frameStart;
+            _frameNumber = frameNumber;
+            _sentThisFrame = false;
+            _nextBeacon = frameStart + correct(_nominalPeriod);
+            // Slot 0 of the map is the first slot after the beacon.
+            _slotStart = frameStart + correct((unsigned long)(_slot + 1) * _slotMicroseconds) + _guardMicroseconds;
+            _slotEnd = frameStart + correct((unsigned long)(_slot + 2) * _slotMicroseconds) - _guardMicroseconds;
+        }
+
+        /**
+         Scales a time offset from the gateway's clock to ours.
+         */
+        unsigned long correct(unsigned long offset) const {
+            if(_nominalPeriod == 0) {
+                return offset;
+            }
+            return offset + _statistics.driftMicroseconds * (long)offset / (long)_nominalPeriod;
+        }
+
+        void transmitInSlot() {
+            _sentThisFrame = true;
+            T *interface = _controller->getInterface();
+
+            _controller->setPoweredUp(true);
+            // TX_ADDR and RX_ADDR_P0 both point at the gateway while we send, so its ACKs come back to us.
+            _controller->setPrimaryTransmitter();
+            _controller->setAddress(_address, _addressSize);
+            while(!TDMABeacon::reached(interface->micros(), _slotStart));
+
+            bool first = true;
+            while(_queueCount > 0) {
+                unsigned long start = interface->micros();
+                // The slot always fits one packet, so the first one is always tried.
+                if(!first && TDMABeacon::reached(start + _packetMicroseconds, _slotEnd)) {
+                    break;
+                }
+                first = false;
+
+                // Send a copy: the SPI transfer overwrites the buffer and the packet stays queued if it fails.
+                unsigned char packet[TDMABeacon::SIZE];
+                for(unsigned char i = 0; i < TDMABeacon::SIZE; i++) {
+                    packet[i] = _queue[_queueHead][i];
+                }
+                // Give up once the guard time after the slot is used up too.
+                bool sent = _controller->sendPacketAndWait(packet, TDMABeacon::SIZE, false, _slotEnd + _guardMicroseconds - start);
+
+                if(!sent) {
+                    // Leave the packet queued and try again next frame. A failed send took as long as it was allowed to,
+                    // which says nothing about how long sending takes.
+                    _statistics.packetsFailed++;
+                    break;
+                }
+                unsigned long duration = interface->micros() - start;
+                if(duration > _packetMicroseconds) {
+                    _packetMicroseconds = duration;
+                } else {
+                    _packetMicroseconds -= (_packetMicroseconds - duration) / 8;
+                }
+                _statistics.packetsSent++;
+                _queueHead = (_queueHead + 1) % QueueDepth;
+                _queueCount--;
+            }
+        }
+
+        void sleep() {
+            _controller->concludeSendingPacket();
+            _controller->setPoweredUp(false);
+            _state = State::Sleeping;
+        }
+
+        void listen() {
+            _controller->setPoweredUp(true);
+            _controller->setPrimaryReceiver();
+            // Only RX_ADDR_P0 changes as a primary receiver. Packets other nodes send to the gateway don't match it, so we never ACK them.
+            _controller->setAddress(_beaconAddress, _addressSize);
+        }
+    };
+}
+
+#endif /* TDMA_hpp */
@@ -0,0 +1,27 @@
+//
+//  Check.hpp
+//
+//
+//
+
+#ifndef Check_hpp
+#define Check_hpp
+
+#include <cstdio>
+
+/**
+ @return The number of failed checks so far. Tests return this from `main`, so `make test` fails if anything did.
+ */
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool passed, const char *what) {
+    printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+    if(!passed) {
+        failures()++;
+    }
+}
+
+#endif /* Check_hpp */
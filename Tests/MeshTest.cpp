@@ -0,0 +1,257 @@
+//
+//  MeshTest.cpp
+//
+//  A chain of mesh nodes where every node only reaches its neighbours. Every node sends to the root and the root sends
+//  back to the far end, which checks forwarding in both directions and measures how long each hop takes. Then a diamond,
+//  where the root reaches a leaf through either of two nodes, loses the node its route goes through and has to find
+//  its way around it.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+#include "Mesh.hpp"
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> SimulatedController;
+typedef MeshNode<SimulatedInterface> Node;
+
+static const unsigned char NODE_COUNT = 5;
+static const unsigned long long RUN_MICROSECONDS = 20000000;
+// Wait for the routes to settle before counting anything.
+static const unsigned long WARM_UP_MICROSECONDS = 1200000;
+static const unsigned long SEND_INTERVAL = 100000;
+static const unsigned long ADVERTISE_INTERVAL = 500000;
+
+struct Flow {
+    unsigned long sent;
+    unsigned long delivered;
+    unsigned long long totalLatency;
+    unsigned long maxLatency;
+};
+
+static SimulatedController *controllers[NODE_COUNT];
+static Node *nodes[NODE_COUNT];
+// Frames from every node to the root, and from the root to the last node.
+static Flow upstream[NODE_COUNT];
+static Flow downstream;
+
+static unsigned long now(unsigned char node) {
+    return controllers[node]->getInterface()->micros();
+}
+
+static void writeStamp(unsigned char *data, unsigned long value) {
+    for(unsigned char i = 0; i < 4; i++) {
+        data[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static unsigned long readStamp(const unsigned char *data) {
+    unsigned long value = 0;
+    for(unsigned char i = 0; i < 4; i++) {
+        value |= (unsigned long)data[i] << (8 * i);
+    }
+    return value;
+}
+
+static void record(Flow &flow, unsigned long latency) {
+    flow.delivered++;
+    flow.totalLatency += latency;
+    if(latency > flow.maxLatency) {
+        flow.maxLatency = latency;
+    }
+}
+
+static void deliveredToRoot(unsigned char source, unsigned char *data, unsigned char size) {
+    if(size == 5 && data[4] && source < NODE_COUNT) {
+        record(upstream[source], now(0) - readStamp(data));
+    }
+}
+
+static void deliveredToLast(unsigned char source, unsigned char *data, unsigned char size) {
+    if(size == 5 && data[4] && source == 0) {
+        record(downstream, now(NODE_COUNT - 1) - readStamp(data));
+    }
+}
+
+static void runNode(unsigned char id) {
+    Node *node = nodes[id];
+    unsigned long start = now(id);
+    // Spread the nodes out a bit so they don't all send at the same moment.
+    unsigned long nextSend = start + id * 3000;
+    unsigned long nextAdvertisement = start + id * 7000;
+    // Real nodes don't send on a perfectly fixed schedule. Without some jitter the same frames would collide every time.
+    unsigned long seed = id + 1;
+    while(true) {
+        node->poll();
+        unsigned long time = now(id);
+        if(id > 0 && time - nextAdvertisement < 0x80000000UL) {
+            nextAdvertisement += ADVERTISE_INTERVAL;
+            node->advertiseRoutes(id - 1);
+        }
+        if(time - nextSend < 0x80000000UL) {
+            seed = seed * 1103515245 + 12345;
+            nextSend += SEND_INTERVAL - SEND_INTERVAL / 4 + (seed >> 16) % (SEND_INTERVAL / 2);
+            // The send time, and whether the frame counts towards the results
+            unsigned char stamp[5];
+            writeStamp(stamp, time);
+            bool counted = time - start > WARM_UP_MICROSECONDS;
+            stamp[4] = counted;
+            if(id > 0 && node->send(0, stamp, 5) && counted) {
+                upstream[id].sent++;
+            } else if(id == 0 && node->send(NODE_COUNT - 1, stamp, 5) && counted) {
+                downstream.sent++;
+            }
+        }
+        controllers[id]->getInterface()->delayMicroseconds(50);
+    }
+}
+
+static const unsigned char DIAMOND_COUNT = 4;
+static const unsigned char DIAMOND_LEAF = DIAMOND_COUNT - 1;
+static const unsigned long long DIAMOND_MICROSECONDS = 6000000;
+static const unsigned long DIAMOND_FAILURE = 2000000;
+// Frames sent this long after the failure count towards the results, which leaves time for an advertisement.
+static const unsigned long DIAMOND_RECOVERY = 1000000;
+
+static SimulatedController *diamondControllers[DIAMOND_COUNT];
+static Node *diamondNodes[DIAMOND_COUNT];
+static Flow diamondFlow;
+// The root and the leaf each neighbour both nodes in the middle.
+static const unsigned char diamondNeighbours[DIAMOND_COUNT][2] = {{1, 2}, {0, 3}, {0, 3}, {1, 2}};
+
+static void deliveredToLeaf(unsigned char source, unsigned char *data, unsigned char size) {
+    if(size == 5 && data[4] && source == 0) {
+        diamondFlow.delivered++;
+    }
+}
+
+static void runDiamondNode(unsigned char id) {
+    Node *node = diamondNodes[id];
+    SimulatedInterface *interface = diamondControllers[id]->getInterface();
+    unsigned long start = interface->micros();
+    unsigned long nextSend = start;
+    unsigned long nextAdvertisement = start + id * 7000;
+    while(true) {
+        node->poll();
+        unsigned long time = interface->micros();
+        if(time - nextAdvertisement < 0x80000000UL) {
+            nextAdvertisement += ADVERTISE_INTERVAL;
+            node->advertiseRoutes(diamondNeighbours[id][0]);
+            node->advertiseRoutes(diamondNeighbours[id][1]);
+        }
+        if(id == 0 && time - nextSend < 0x80000000UL) {
+            nextSend += SEND_INTERVAL;
+            unsigned char stamp[5];
+            writeStamp(stamp, time);
+            bool counted = time - start > DIAMOND_FAILURE + DIAMOND_RECOVERY;
+            stamp[4] = counted;
+            if(node->send(DIAMOND_LEAF, stamp, 5) && counted) {
+                diamondFlow.sent++;
+            }
+        }
+        interface->delayMicroseconds(50);
+    }
+}
+
+int main() {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    medium.setRange(12);
+    const unsigned char prefix[] = {0x34, 0x56, 0x78, 0x9A};
+
+    for(unsigned char id = 0; id < NODE_COUNT; id++) {
+        SimulatedController *n = new SimulatedController(8, 2, 10);
+        n->getInterface()->getRadio()->setPosition(10 * id);
+        n->setPoweredUp(true);
+        n->setBitrate(2);
+        n->setAutoAcknowledgementEnabled(true);
+        n->setAutoRetransmitCount(5);
+        controllers[id] = n;
+
+        Node *node = new Node(n, id, prefix);
+        if(id > 0) {
+            node->setParent(id - 1);
+        }
+        node->setDeliveryHandler(id == 0 ? deliveredToRoot : deliveredToLast);
+        node->begin();
+        nodes[id] = node;
+        medium.spawn([id]() { runNode(id); });
+    }
+
+    medium.runFor(RUN_MICROSECONDS);
+
+    printf("Mesh: %u nodes in a chain, each only in range of its neighbours, 1 frame every %lums per node\n", NODE_COUNT, SEND_INTERVAL / 1000);
+    printf("flow       hops  sent  delivered  avg latency (us)  avg per hop (us)  max latency (us)\n");
+    bool allDelivered = true;
+    for(unsigned char id = 0; id < NODE_COUNT; id++) {
+        Flow &flow = id == 0 ? downstream : upstream[id];
+        unsigned char hops = id == 0 ? NODE_COUNT - 1 : id;
+        unsigned long average = flow.delivered > 0 ? (unsigned long)(flow.totalLatency / flow.delivered) : 0;
+        printf("%u -> %u     %4u  %4lu  %9lu  %16lu  %16lu  %16lu\n", id, id == 0 ? NODE_COUNT - 1 : 0, hops, flow.sent, flow.delivered, average, average / hops, flow.maxLatency);
+        allDelivered = allDelivered && flow.sent > 0 && flow.delivered * 100 >= flow.sent * 90;
+    }
+
+    printf("node  forwarded  sent  dropped  last hop latency (us)  max hop latency (us)  retransmits  duplicates  collisions\n");
+    for(unsigned char id = 0; id < NODE_COUNT; id++) {
+        const Node::Statistics &stats = nodes[id]->getStatistics();
+        const SimulatedRadio::Statistics &radio = controllers[id]->getInterface()->getRadio()->getStatistics();
+        printf("%4u  %9lu  %4lu  %7lu  %21lu  %20lu  %11lu  %10lu  %10lu\n", id, stats.forwarded, stats.sent, stats.dropped, stats.lastHopLatency, stats.maxHopLatency, radio.retransmits, radio.duplicatesDiscarded, radio.collisions);
+    }
+
+    check(allDelivered, "at least 90% of the frames arrive in both directions");
+    check(nodes[1]->getStatistics().forwarded > 0 && nodes[NODE_COUNT - 2]->getStatistics().forwarded > 0, "frames are forwarded along the chain");
+    check(nodes[0]->getNextHop(NODE_COUNT - 1) == 1, "the root learned a route to the last node from advertisements");
+
+    medium.reset();
+    for(unsigned char id = 0; id < NODE_COUNT; id++) {
+        delete nodes[id];
+        delete controllers[id];
+    }
+
+    // The root and the leaf are 20 apart, the two nodes in the middle are within range of both.
+    medium.setRange(12);
+    const double positions[DIAMOND_COUNT][2] = {{0, 0}, {10, 5}, {10, -5}, {20, 0}};
+    for(unsigned char id = 0; id < DIAMOND_COUNT; id++) {
+        SimulatedController *n = new SimulatedController(8, 2, 10);
+        n->getInterface()->getRadio()->setPosition(positions[id][0], positions[id][1]);
+        n->setPoweredUp(true);
+        n->setBitrate(2);
+        n->setAutoAcknowledgementEnabled(true);
+        n->setAutoRetransmitCount(5);
+        diamondControllers[id] = n;
+
+        Node *node = new Node(n, id, prefix);
+        node->setDeliveryHandler(deliveredToLeaf);
+        // Nobody has a parent, so the nodes need to know their neighbours to advertise to them.
+        node->addRoute(diamondNeighbours[id][0], diamondNeighbours[id][0], 1);
+        node->addRoute(diamondNeighbours[id][1], diamondNeighbours[id][1], 1);
+        node->begin();
+        diamondNodes[id] = node;
+        medium.spawn([id]() { runDiamondNode(id); });
+    }
+
+    medium.runFor(DIAMOND_FAILURE);
+    unsigned char lost = diamondNodes[0]->getNextHop(DIAMOND_LEAF);
+    unsigned char survivor = lost == 1 ? 2 : 1;
+    bool routed = lost == 1 || lost == 2;
+    if(routed) {
+        // Out of everyone's range.
+        diamondControllers[lost]->getInterface()->getRadio()->setPosition(1000);
+    }
+    medium.runFor(DIAMOND_MICROSECONDS - DIAMOND_FAILURE);
+
+    printf("Diamond: the root reaches the leaf through node 1 or 2, node %u goes away after %lums\n", lost, DIAMOND_FAILURE / 1000);
+    printf("sent after recovering %lu, delivered %lu, root's next hop to the leaf %u, dropped by the root %lu\n", diamondFlow.sent, diamondFlow.delivered, diamondNodes[0]->getNextHop(DIAMOND_LEAF), diamondNodes[0]->getStatistics().dropped);
+
+    check(routed, "the root learned a route to the leaf through one of the nodes in the middle");
+    check(diamondNodes[0]->getNextHop(DIAMOND_LEAF) == survivor, "the root routes around a next hop that went away");
+    check(diamondFlow.sent > 0 && diamondFlow.delivered * 100 >= diamondFlow.sent * 90, "at least 90% of the frames arrive once the route recovered");
+
+    medium.reset();
+    for(unsigned char id = 0; id < DIAMOND_COUNT; id++) {
+        delete diamondNodes[id];
+        delete diamondControllers[id];
+    }
+    return failures();
+}
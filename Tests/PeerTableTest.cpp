@@ -0,0 +1,239 @@
+//
+//  PeerTableTest.cpp
+//
+//  One transmitter sending queued packets to two receivers with a `PeerTable`, including after the address was changed
+//  behind the table's back. Checks that every packet reaches the peer it was queued for and that `addressSwitches` only
+//  counts the times the nRF really had to be reprogrammed. Then measures fanning out to 8 receivers, like the FanOut
+//  sketch, with a full address write before every send, with `setAddress` before every send and through a `PeerTable`.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+#include "PeerTable.hpp"
+#include "CountingInterface.hpp"
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> SimulatedController;
+
+static const unsigned char PEER_COUNT = 2;
+
+static unsigned char addresses[PEER_COUNT][5] = {
+    {0x11, 0x34, 0x56, 0x78, 0x9A},
+    {0x22, 0x34, 0x56, 0x78, 0x9A},
+};
+
+static unsigned long received[PEER_COUNT];
+static unsigned long misdelivered = 0;
+
+typedef CountingInterface<SimulatedInterface> FanOutInterface;
+typedef Controller<FanOutInterface> FanOutController;
+
+static const unsigned char FAN_OUT_PEERS = 8;
+static const unsigned int FAN_OUT_PACKETS = 800;
+static const unsigned char FAN_OUT_QUEUE_DEPTH = 16;
+
+// The receivers' addresses only differ in their first byte.
+static unsigned char fanOutAddresses[FAN_OUT_PEERS][5];
+
+enum class FanOut : unsigned char {
+    FullWrite,
+    SetAddress,
+    PeerTable
+};
+
+struct FanOutResult {
+    unsigned long microseconds;
+    SPICost cost;
+};
+
+/**
+ Writes SETUP_AW, TX_ADDR and RX_ADDR_P0 in full, like `setAddress` did before it remembered the addresses.
+ */
+static void writeFullAddress(FanOutInterface *interface, const unsigned char address[5]) {
+    // W_REGISTER | SETUP_AW, 5 byte addresses
+    interface->beginTransaction();
+    interface->transferByte(0x20 | 0x03);
+    interface->transferByte(0x03);
+    interface->endTransaction();
+    const unsigned char registers[] = {0x10, 0x0A};
+    for(unsigned char r = 0; r < 2; r++) {
+        unsigned char data[5];
+        unsigned char *pointer = data;
+        for(unsigned char i = 0; i < 5; i++) {
+            data[i] = address[i];
+        }
+        interface->beginTransaction();
+        interface->transferByte(0x20 | registers[r]);
+        interface->transferBytes(&pointer, 5);
+        interface->endTransaction();
+    }
+}
+
+/**
+ Sends packets round robin to 8 receivers without ACKs, so no receivers are needed, and measures the time and SPI traffic.
+ */
+static FanOutResult measureFanOut(FanOut method) {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    medium.reset();
+
+    FanOutController *n = new FanOutController(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setPrimaryTransmitter();
+    n->setAutoAcknowledgementEnabled(false);
+    n->setUsesDynamicPayloadLength(false);
+    n->setDynamicACKEnabled(true);
+    n->setBitrate(2);
+    n->setAutoRetransmitCount(0);
+
+    PeerTable<FanOutInterface, FAN_OUT_PEERS, FAN_OUT_QUEUE_DEPTH> *peers = new PeerTable<FanOutInterface, FAN_OUT_PEERS, FAN_OUT_QUEUE_DEPTH>(n);
+    for(unsigned char i = 0; i < FAN_OUT_PEERS; i++) {
+        const unsigned char address[5] = {(unsigned char)(0x10 + i), 0x34, 0x56, 0x78, 0x9A};
+        for(unsigned char j = 0; j < 5; j++) {
+            fanOutAddresses[i][j] = address[j];
+        }
+        peers->setPeer(i, address, 5);
+    }
+
+    FanOutResult result = FanOutResult();
+    bool done = false;
+    medium.spawn([n, peers, method, &result, &done]() {
+        FanOutInterface *interface = n->getInterface();
+        interface->resetCost();
+        unsigned long start = interface->micros();
+        unsigned char packet[32] = {0};
+        for(unsigned int i = 0; i < FAN_OUT_PACKETS; i++) {
+            unsigned char peer = i % FAN_OUT_PEERS;
+            switch(method) {
+                case FanOut::FullWrite:
+                    writeFullAddress(interface, fanOutAddresses[peer]);
+                    n->sendPacketAndWait(packet, 32, true);
+                    break;
+                case FanOut::SetAddress:
+                    n->setAddress(fanOutAddresses[peer], 5);
+                    n->sendPacketAndWait(packet, 32, true);
+                    break;
+                case FanOut::PeerTable:
+                    // Every flush sends two rounds, grouped by destination.
+                    if(!peers->queue(peer, packet, 32, true)) {
+                        peers->flush();
+                        peers->queue(peer, packet, 32, true);
+                    }
+                    break;
+            }
+        }
+        peers->flush();
+        result.microseconds = interface->micros() - start;
+        result.cost = interface->getCost();
+        done = true;
+        while(true) {
+            interface->delayMicroseconds(1000);
+        }
+    });
+    while(!done) {
+        medium.runFor(100000);
+    }
+
+    medium.reset();
+    delete peers;
+    delete n;
+    return result;
+}
+
+int main() {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+
+    SimulatedController *receivers[PEER_COUNT];
+    for(unsigned char i = 0; i < PEER_COUNT; i++) {
+        SimulatedController *n = new SimulatedController(8, 2, 10);
+        receivers[i] = n;
+        n->setPoweredUp(true);
+        n->setBitrate(2);
+        n->setUsesDynamicPayloadLength(false);
+        n->setReceivedPacketLength(32);
+        n->setPrimaryReceiver();
+        n->setAddress(addresses[i], 5);
+        medium.spawn([n, i]() {
+            while(true) {
+                while(n->dataInRXFIFO()) {
+                    unsigned char data[32];
+                    n->readData(data, 32);
+                    if(data[0] == i) {
+                        received[i]++;
+                    } else {
+                        misdelivered++;
+                    }
+                }
+                n->getInterface()->delayMicroseconds(100);
+            }
+        });
+    }
+
+    SimulatedController *sender = new SimulatedController(8, 2, 10);
+    sender->setPoweredUp(true);
+    sender->setBitrate(2);
+    sender->setUsesDynamicPayloadLength(false);
+    sender->setPrimaryTransmitter();
+    // Already pointed at peer 0, so sending to it first costs no switch.
+    sender->setAddress(addresses[0], 5);
+    PeerTable<SimulatedInterface> *table = new PeerTable<SimulatedInterface>(sender);
+    for(unsigned char i = 0; i < PEER_COUNT; i++) {
+        table->setPeer(i, addresses[i], 5);
+    }
+
+    unsigned long sent = 0;
+    unsigned long switchesBefore = 0;
+    unsigned long switchesAfter = 0;
+    medium.spawn([sender, table, &sent, &switchesBefore, &switchesAfter]() {
+        const unsigned char round[] = {0, 1, 0, 1};
+        for(unsigned char i = 0; i < sizeof(round); i++) {
+            unsigned char data[32] = {round[i]};
+            table->queue(round[i], data, 32);
+        }
+        sent += table->flush();
+        switchesBefore = table->getStatistics().addressSwitches;
+
+        // Someone else points the nRF at peer 0 while the table still thinks it's at peer 1.
+        sender->setAddress(addresses[0], 5);
+        unsigned char data[32] = {1};
+        table->queue(1, data, 32);
+        sent += table->flush();
+        switchesAfter = table->getStatistics().addressSwitches;
+
+        while(true) {
+            sender->getInterface()->delayMicroseconds(1000);
+        }
+    });
+
+    medium.runFor(100000);
+
+    printf("PeerTable: 2 peers, 5 packets, the address changed from outside before the last one\n");
+    printf("sent %lu, received by peer 0 %lu, by peer 1 %lu, misdelivered %lu, address switches %lu then %lu\n", sent, received[0], received[1], misdelivered, switchesBefore, switchesAfter);
+
+    check(sent == 5 && table->getStatistics().packetsFailed == 0, "every packet is sent");
+    check(received[0] == 2 && received[1] == 3 && misdelivered == 0, "every packet reaches the peer it was queued for, even after an outside setAddress");
+    // Peer 0 was already selected, so the first round only switches to peer 1, and the outside change forces one more.
+    check(switchesBefore == 1 && switchesAfter == 2, "address switches count only real writes to the nRF");
+
+    medium.reset();
+    delete table;
+    delete sender;
+    for(unsigned char i = 0; i < PEER_COUNT; i++) {
+        delete receivers[i];
+    }
+
+    const char *names[] = {"full address write", "setAddress", "PeerTable"};
+    FanOutResult results[3];
+    printf("Fan out: %u packets round robin to %u receivers, no ACKs, 2Mbps\n", FAN_OUT_PACKETS, FAN_OUT_PEERS);
+    printf("method              packets/s  transactions/packet  bytes/packet\n");
+    for(unsigned char i = 0; i < 3; i++) {
+        results[i] = measureFanOut((FanOut)i);
+        printf("%-18s  %9.0f  %19.2f  %12.2f\n", names[i], FAN_OUT_PACKETS * 1000000.0 / results[i].microseconds, (double)results[i].cost.transactions / FAN_OUT_PACKETS, (double)results[i].cost.bytes / FAN_OUT_PACKETS);
+    }
+    const FanOutResult &fullWrite = results[(unsigned char)FanOut::FullWrite];
+    const FanOutResult &peerTable = results[(unsigned char)FanOut::PeerTable];
+    check(peerTable.microseconds < fullWrite.microseconds, "the peer table sends faster than writing the full address before every send");
+    check(peerTable.cost.bytes < fullWrite.cost.bytes, "the peer table sends fewer SPI bytes than writing the full address before every send");
+    return failures();
+}
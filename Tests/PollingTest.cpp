@@ -0,0 +1,200 @@
+//
+//  PollingTest.cpp
+//
+//  A sender sending bursts of back to back packets with quiet gaps in between, and a receiver picking them up with
+//  `pollInterruptBits` in each IRQ mode. Reports the latency from sending to reading each packet and what the receiver
+//  spent on the SPI bus to get it, and checks that Hybrid busy polls through the bursts and stops during the gaps.
+//  Then the sender sends flat out without any gaps and the test reports how many packets per second each mode receives.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+#include "CountingInterface.hpp"
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> Sender;
+typedef Controller<CountingInterface<SimulatedInterface> > Receiver;
+
+static const unsigned long long RUN_MICROSECONDS = 1000000;
+static const unsigned int BURST_PACKETS = 50;
+static const unsigned long BURST_GAP_MICROSECONDS = 20000;
+// What the rest of the receiver's loop takes.
+static const unsigned long LOOP_WORK_MICROSECONDS = 20;
+static const unsigned long IDLE_POLL_INTERVAL = 1000;
+
+struct Regime {
+    const char *name;
+    Receiver::IRQMode mode;
+    bool hasIRQPin;
+};
+
+struct Result {
+    unsigned long sent;
+    unsigned long received;
+    unsigned long receivedWhileBusy;
+    unsigned long long totalLatency;
+    unsigned long maxLatency;
+    unsigned long transactions;
+};
+
+static unsigned char address[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+
+static void writeStamp(unsigned char *data, unsigned long value) {
+    for(unsigned char i = 0; i < 4; i++) {
+        data[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static unsigned long readStamp(const unsigned char *data) {
+    unsigned long value = 0;
+    for(unsigned char i = 0; i < 4; i++) {
+        value |= (unsigned long)data[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ Runs a sender and a receiver in the given IRQ mode.
+ @param regime The receiver's IRQ mode.
+ @param saturated Whether the sender sends back to back without any gaps, rather than in bursts.
+ */
+static Result run(const Regime &regime, bool saturated) {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    medium.reset();
+    Result result = Result();
+
+    Sender *sender = new Sender(8, 2, 10);
+    sender->setPoweredUp(true);
+    sender->setBitrate(2);
+    sender->setAutoAcknowledgementEnabled(false);
+    sender->setUsesDynamicPayloadLength(false);
+    sender->setPrimaryTransmitter();
+    sender->setAddress(address, 5);
+
+    Receiver *receiver = new Receiver(8, regime.hasIRQPin ? 2 : SpecialPinHolder::NO_PIN, 10);
+    receiver->setPoweredUp(true);
+    receiver->setBitrate(2);
+    receiver->setAutoAcknowledgementEnabled(false);
+    receiver->setUsesDynamicPayloadLength(false);
+    receiver->setReceivedPacketLength(32);
+    receiver->setPrimaryReceiver();
+    receiver->setAddress(address, 5);
+    receiver->setIRQMode(regime.mode, 100, IDLE_POLL_INTERVAL);
+    if(regime.hasIRQPin) {
+        receiver->getInterface()->getRadio()->setInterruptHandler([receiver]() { receiver->notifyInterrupt(); });
+    }
+    receiver->getInterface()->resetCost();
+
+    medium.spawn([sender, saturated, &result]() {
+        while(true) {
+            for(unsigned int i = 0; i < BURST_PACKETS; i++) {
+                unsigned char packet[32] = {0};
+                writeStamp(packet, sender->getInterface()->micros());
+                sender->startSendingPacket(packet, 32);
+                do {
+                    sender->readAndClearInterruptBits();
+                } while(!sender->didSendPayload());
+                sender->concludeSendingPacket();
+                result.sent++;
+                if(!saturated) {
+                    sender->getInterface()->delayMicroseconds(100);
+                }
+            }
+            if(!saturated) {
+                sender->getInterface()->delayMicroseconds(BURST_GAP_MICROSECONDS);
+            }
+        }
+    });
+
+    // The PollingReceiver example's loop.
+    medium.spawn([receiver, &result]() {
+        while(true) {
+            // Read before polling, which may itself switch to busy polling.
+            bool busy = receiver->isBusyPolling();
+            if(receiver->pollInterruptBits() && receiver->didReceivePayload()) {
+                while(receiver->dataInRXFIFO()) {
+                    unsigned char data[32];
+                    receiver->readData(data, 32);
+                    unsigned long latency = receiver->getInterface()->micros() - readStamp(data);
+                    result.received++;
+                    result.totalLatency += latency;
+                    if(latency > result.maxLatency) {
+                        result.maxLatency = latency;
+                    }
+                    if(busy) {
+                        result.receivedWhileBusy++;
+                    }
+                }
+            }
+            receiver->getInterface()->delayMicroseconds(LOOP_WORK_MICROSECONDS);
+        }
+    });
+
+    medium.runFor(RUN_MICROSECONDS);
+    result.transactions = receiver->getInterface()->getCost().transactions;
+
+    // The processes never return, so forget them before their radios go away.
+    medium.reset();
+    delete sender;
+    delete receiver;
+    return result;
+}
+
+int main() {
+    const Regime regimes[] = {
+        { "Interrupt", Receiver::IRQMode::Interrupt, true },
+        { "Polling", Receiver::IRQMode::Polling, true },
+        { "Hybrid", Receiver::IRQMode::Hybrid, true },
+        { "Hybrid, no IRQ", Receiver::IRQMode::Hybrid, false },
+    };
+    const unsigned char count = sizeof(regimes) / sizeof(regimes[0]);
+    Result results[count];
+
+    printf("Polling: bursts of %u packets with %lums gaps, %luus of other work per loop, 2Mbps\n", BURST_PACKETS, BURST_GAP_MICROSECONDS / 1000, LOOP_WORK_MICROSECONDS);
+    printf("regime          sent  received  while busy  avg latency (us)  max latency (us)  transactions/packet\n");
+    for(unsigned char i = 0; i < count; i++) {
+        Result &result = results[i];
+        result = run(regimes[i], false);
+        unsigned long average = result.received > 0 ? (unsigned long)(result.totalLatency / result.received) : 0;
+        double perPacket = result.received > 0 ? (double)result.transactions / result.received : 0;
+        printf("%-14s  %4lu  %8lu  %10lu  %16lu  %16lu  %19.1f\n", regimes[i].name, result.sent, result.received, result.receivedWhileBusy, average, result.maxLatency, perPacket);
+    }
+
+    const Result &interrupt = results[0];
+    const Result &polling = results[1];
+    const Result &hybrid = results[2];
+    const Result &noIRQ = results[3];
+    bool allReceived = true;
+    for(unsigned char i = 0; i < count; i++) {
+        // The last packet may still be on the air when the run ends.
+        allReceived = allReceived && results[i].sent > 0 && results[i].received + 1 >= results[i].sent;
+    }
+    check(allReceived, "every regime receives every packet");
+    check(hybrid.receivedWhileBusy * 10 >= hybrid.received * 9, "Hybrid busy polls through the bursts");
+    // Both busy poll through the bursts, Polling also spins through the gaps.
+    check(hybrid.transactions * 3 < polling.transactions * 2, "Hybrid stops polling during the gaps");
+    // Compares the averages. The simulation leaves out what entering the interrupt routine costs, so Interrupt comes out a little flattered.
+    check(hybrid.totalLatency * interrupt.received <= interrupt.totalLatency * hybrid.received, "Hybrid is at least as fast as waiting for an interrupt per packet");
+    check(noIRQ.maxLatency <= IDLE_POLL_INTERVAL + 1000, "without an IRQ pin a packet waits at most about one idle poll interval");
+
+    Result saturated[count];
+    printf("Saturation: packets back to back for %llums, %luus of other work per loop, 2Mbps\n", RUN_MICROSECONDS / 1000, LOOP_WORK_MICROSECONDS);
+    printf("regime          sent/s  received/s  avg latency (us)  transactions/packet\n");
+    for(unsigned char i = 0; i < count; i++) {
+        Result &result = saturated[i];
+        result = run(regimes[i], true);
+        unsigned long average = result.received > 0 ? (unsigned long)(result.totalLatency / result.received) : 0;
+        double perPacket = result.received > 0 ? (double)result.transactions / result.received : 0;
+        printf("%-14s  %6.0f  %10.0f  %16lu  %19.1f\n", regimes[i].name, result.sent * 1000000.0 / RUN_MICROSECONDS, result.received * 1000000.0 / RUN_MICROSECONDS, average, perPacket);
+    }
+
+    bool keptUp = true;
+    for(unsigned char i = 0; i < count; i++) {
+        keptUp = keptUp && saturated[i].sent > 0 && saturated[i].received + 1 >= saturated[i].sent;
+    }
+    check(keptUp, "every regime keeps up with a sender going flat out");
+    check(saturated[2].receivedWhileBusy * 10 >= saturated[2].received * 9 && saturated[3].receivedWhileBusy * 10 >= saturated[3].received * 9, "Hybrid keeps busy polling while packets never stop coming");
+    return failures();
+}
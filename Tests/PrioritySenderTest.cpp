@@ -0,0 +1,135 @@
+//
+//  PrioritySenderTest.cpp
+//
+//  A `PrioritySender` keeping its bulk queue full while control packets keep cutting in, so nearly every control packet
+//  preempts a bulk packet that's on the air. Checks that the receiver gets every packet exactly once and in order,
+//  and reports how long control packets wait.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+#include "PrioritySender.hpp"
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> SimulatedController;
+typedef PrioritySender<SimulatedInterface> Sender;
+
+static const unsigned long long RUN_MICROSECONDS = 1000000;
+static const unsigned long CONTROL_INTERVAL = 5000;
+// Waiting for the bulk packet on the air plus sending the control packet, with room for a few retransmits.
+static const unsigned long MAX_CONTROL_LATENCY = 3000;
+
+static unsigned char address[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+
+struct Flow {
+    unsigned long queued;
+    unsigned long received;
+    unsigned long duplicates;
+    unsigned long skipped;
+};
+
+static Flow flows[Sender::PRIORITY_COUNT];
+
+static void writeSequence(unsigned char *data, unsigned long value) {
+    for(unsigned char i = 0; i < 4; i++) {
+        data[1 + i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static unsigned long readSequence(const unsigned char *data) {
+    unsigned long value = 0;
+    for(unsigned char i = 0; i < 4; i++) {
+        value |= (unsigned long)data[1 + i] << (8 * i);
+    }
+    return value;
+}
+
+static bool queue(Sender *sender, Sender::Priority priority) {
+    Flow &flow = flows[(unsigned char)priority];
+    unsigned char data[32] = {(unsigned char)priority};
+    writeSequence(data, flow.queued);
+    if(!sender->queue(priority, data, 32)) {
+        return false;
+    }
+    flow.queued++;
+    return true;
+}
+
+int main() {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+
+    SimulatedController *receiver = new SimulatedController(8, 2, 10);
+    receiver->setPoweredUp(true);
+    receiver->setBitrate(2);
+    receiver->setUsesDynamicPayloadLength(false);
+    receiver->setReceivedPacketLength(32);
+    receiver->setPrimaryReceiver();
+    receiver->setAddress(address, 5);
+    medium.spawn([receiver]() {
+        while(true) {
+            while(receiver->dataInRXFIFO()) {
+                unsigned char data[32];
+                receiver->readData(data, 32);
+                if(data[0] >= Sender::PRIORITY_COUNT) {
+                    continue;
+                }
+                Flow &flow = flows[data[0]];
+                unsigned long sequence = readSequence(data);
+                if(sequence < flow.received) {
+                    flow.duplicates++;
+                    continue;
+                }
+                flow.skipped += sequence - flow.received;
+                flow.received = sequence + 1;
+            }
+            receiver->getInterface()->delayMicroseconds(50);
+        }
+    });
+
+    SimulatedController *controller = new SimulatedController(8, 2, 10);
+    controller->setPoweredUp(true);
+    controller->setBitrate(2);
+    controller->setUsesDynamicPayloadLength(false);
+    controller->setAutoRetransmitCount(15);
+    controller->setPrimaryTransmitter();
+    controller->setAddress(address, 5);
+    Sender *sender = new Sender(controller);
+
+    medium.spawn([controller, sender]() {
+        unsigned long nextControl = controller->getInterface()->micros();
+        while(true) {
+            while(queue(sender, Sender::Priority::Bulk));
+            if((long)(controller->getInterface()->micros() - nextControl) >= 0) {
+                queue(sender, Sender::Priority::Control);
+                nextControl += CONTROL_INTERVAL;
+            }
+            sender->service();
+            controller->getInterface()->delayMicroseconds(20);
+        }
+    });
+
+    medium.runFor(RUN_MICROSECONDS);
+
+    const Sender::Statistics &statistics = sender->getStatistics();
+    const Flow &control = flows[(unsigned char)Sender::Priority::Control];
+    const Flow &bulk = flows[(unsigned char)Sender::Priority::Bulk];
+    printf("PrioritySender: bulk packets back to back, a control packet every %lums, 2Mbps\n", CONTROL_INTERVAL / 1000);
+    printf("control queued %lu, received %lu, duplicates %lu, skipped %lu\n", control.queued, control.received, control.duplicates, control.skipped);
+    printf("bulk queued %lu, received %lu, duplicates %lu, skipped %lu\n", bulk.queued, bulk.received, bulk.duplicates, bulk.skipped);
+    printf("preemptions %lu, failed %lu, max control latency %luus\n", statistics.preemptions, statistics.packetsFailed[0] + statistics.packetsFailed[2], statistics.maxControlLatency);
+
+    // A full queue of packets may still be waiting or on the air when the run ends.
+    check(control.received + 1 >= control.queued && bulk.received + 4 >= bulk.queued, "every packet is received");
+    check(control.duplicates == 0 && bulk.duplicates == 0, "no packet arrives twice");
+    check(control.skipped == 0 && bulk.skipped == 0, "packets of each priority arrive in order without gaps");
+    check(statistics.preemptions * 2 >= control.queued, "control packets preempt bulk packets");
+    check(statistics.maxControlLatency <= MAX_CONTROL_LATENCY, "a control packet only waits for the packet on the air");
+
+    medium.reset();
+    delete sender;
+    delete controller;
+    delete receiver;
+    return failures();
+}
@@ -0,0 +1,160 @@
+//
+//  RepeatTest.cpp
+//
+//  A transmitter repeating packets with `startRepeatingPacket` and `continueRepeatingPacket` to a receiver. Checks that a
+//  counted repeat puts exactly that many transmissions on the air, that `cancelRepeatingPacket` stops repeating forever,
+//  that a normal send afterwards sends its own payload and that `isReusingTXPayload` follows the TX_REUSE bit throughout.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> SimulatedController;
+
+static const unsigned int REPEATS = 5;
+static const unsigned int FOREVER_SENDS = 3;
+
+static unsigned char address[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+
+// Packets received, by their first byte
+static unsigned long received[256];
+static unsigned char lastReceived = 0;
+
+struct Result {
+    bool done;
+    unsigned long countedTransmissions;
+    unsigned long foreverTransmissions;
+    unsigned long afterCancel;
+    bool stoppedAfterCancel;
+    unsigned long countedReceived;
+    unsigned long normalReceived;
+    unsigned long staleAfterNormal;
+    unsigned char lastAfterNormal;
+    // Whether `isReusingTXPayload` agreed with the TX_REUSE bit and with what it should be at every step
+    bool reuseMatches;
+};
+
+static unsigned long transmissions(SimulatedController *n) {
+    return n->getInterface()->getRadio()->getStatistics().transmissions;
+}
+
+static void waitUntilSent(SimulatedController *n) {
+    do {
+        n->readAndClearInterruptBits();
+    } while(!n->didSendPayload());
+}
+
+static void checkReuse(SimulatedController *n, bool expected, Result &result) {
+    bool reusing = n->isReusingTXPayload();
+    bool bit = (n->getFIFOStatus() & 0x40) != 0;
+    result.reuseMatches = result.reuseMatches && reusing == bit && reusing == expected;
+}
+
+int main() {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+
+    SimulatedController *receiver = new SimulatedController(8, 2, 10);
+    receiver->setPoweredUp(true);
+    receiver->setBitrate(2);
+    receiver->setUsesDynamicPayloadLength(false);
+    receiver->setReceivedPacketLength(32);
+    receiver->setPrimaryReceiver();
+    receiver->setAddress(address, 5);
+    medium.spawn([receiver]() {
+        while(true) {
+            while(receiver->dataInRXFIFO()) {
+                unsigned char data[32];
+                receiver->readData(data, 32);
+                received[data[0]]++;
+                lastReceived = data[0];
+            }
+            receiver->getInterface()->delayMicroseconds(50);
+        }
+    });
+
+    SimulatedController *sender = new SimulatedController(8, 2, 10);
+    sender->setPoweredUp(true);
+    sender->setBitrate(2);
+    sender->setUsesDynamicPayloadLength(false);
+    // Repeats go out without asking for an ACK.
+    sender->setDynamicACKEnabled(true);
+    sender->setPrimaryTransmitter();
+    sender->setAddress(address, 5);
+
+    Result result = Result();
+    result.reuseMatches = true;
+    medium.spawn([sender, &result]() {
+        SimulatedInterface *interface = sender->getInterface();
+        checkReuse(sender, false, result);
+
+        // A counted repeat, continued after every send until it runs out.
+        unsigned long before = transmissions(sender);
+        unsigned char counted[32] = {'A'};
+        sender->startRepeatingPacket(counted, 32, REPEATS);
+        checkReuse(sender, true, result);
+        do {
+            waitUntilSent(sender);
+        } while(sender->continueRepeatingPacket());
+        interface->delayMicroseconds(2000);
+        result.countedTransmissions = transmissions(sender) - before;
+        result.countedReceived = received['A'];
+        checkReuse(sender, true, result);
+
+        // Repeating forever until cancelled.
+        before = transmissions(sender);
+        unsigned char forever[32] = {'B'};
+        sender->startRepeatingPacket(forever, 32);
+        for(unsigned int i = 1; i < FOREVER_SENDS; i++) {
+            waitUntilSent(sender);
+            sender->continueRepeatingPacket();
+        }
+        waitUntilSent(sender);
+        sender->cancelRepeatingPacket();
+        checkReuse(sender, false, result);
+        result.stoppedAfterCancel = !sender->isRepeatingPacket() && !sender->continueRepeatingPacket();
+        result.foreverTransmissions = transmissions(sender) - before;
+        interface->delayMicroseconds(2000);
+        result.afterCancel = transmissions(sender) - before - result.foreverTransmissions;
+
+        // A normal send in the middle of repeating replaces the repeated payload.
+        unsigned char stale[32] = {'C'};
+        sender->startRepeatingPacket(stale, 32);
+        waitUntilSent(sender);
+        interface->delayMicroseconds(2000);
+        unsigned long staleBefore = received['C'];
+        unsigned char normal[32] = {'D'};
+        sender->startSendingPacket(normal, 32);
+        checkReuse(sender, false, result);
+        waitUntilSent(sender);
+        sender->concludeSendingPacket();
+        interface->delayMicroseconds(2000);
+        result.normalReceived = received['D'];
+        result.staleAfterNormal = received['C'] - staleBefore;
+        result.lastAfterNormal = lastReceived;
+        checkReuse(sender, false, result);
+
+        result.done = true;
+        while(true) {
+            interface->delayMicroseconds(1000);
+        }
+    });
+
+    medium.runFor(100000);
+
+    printf("Repeat: %u counted repeats, %u sends repeating forever then cancelled, then a normal send\n", REPEATS, FOREVER_SENDS);
+    printf("counted: transmissions %lu, received %lu; forever: transmissions %lu, after cancel %lu; normal: received %lu, stale after it %lu\n", result.countedTransmissions, result.countedReceived, result.foreverTransmissions, result.afterCancel, result.normalReceived, result.staleAfterNormal);
+
+    check(result.done, "the sender gets through every step");
+    check(result.countedTransmissions == REPEATS && result.countedReceived == REPEATS, "a counted repeat puts exactly that many transmissions on the air");
+    check(result.foreverTransmissions == FOREVER_SENDS && result.afterCancel == 0 && result.stoppedAfterCancel, "cancelRepeatingPacket stops the repeats");
+    check(result.normalReceived == 1 && result.staleAfterNormal == 0 && result.lastAfterNormal == 'D', "a normal send after repeating sends its own payload, not the repeated one");
+    check(result.reuseMatches, "isReusingTXPayload follows the TX_REUSE bit");
+
+    medium.reset();
+    delete sender;
+    delete receiver;
+    return failures();
+}
@@ -0,0 +1,41 @@
+//
+//  SPICostTest.cpp
+//
+//  The SPICost sketch's steps run against the simulated nRF24L01+, checked against the budgets in
+//  Examples/SPICost/SPIBudget.h. Fails when any call costs more SPI traffic than its budget allows.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "SPICostSteps.h"
+
+using namespace nRF24L01;
+
+typedef SPICostSteps<SimulatedInterface> Steps;
+
+static void report(Steps::Controller *n, const char *name) {
+    const SPICost &cost = n->getInterface()->getCost();
+    char message[160];
+    snprintf(message, sizeof(message), "%s: transactions %lu, bytes %lu, CSN toggles %lu, delay (us) %lu", name, cost.transactions, cost.bytes, cost.CSNToggles, cost.delayMicroseconds);
+    check(withinBudget(name, cost), message);
+}
+
+int main() {
+    printf("SPI cost of every public Controller call, against SPIBudget.h\n");
+    Steps::Controller *n = new Steps::Controller(8, 2, 10);
+    report(n, "Controller");
+    n->setPoweredUp(true);
+
+    unsigned int count;
+    const Steps::Step *steps = Steps::getSteps(count);
+    for(unsigned int i = 0; i < count; i++) {
+        n->getInterface()->resetCost();
+        steps[i].run(n);
+        report(n, steps[i].name);
+    }
+
+    // Every transaction on the simulated bus was whole.
+    check(n->getInterface()->getRadio()->getTransactionViolations() == 0, "no interleaved SPI transactions");
+    delete n;
+    return failures();
+}
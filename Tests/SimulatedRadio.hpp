@@ -0,0 +1,1084 @@
+//
+//  SimulatedRadio.hpp
+//
+//
+//
+
+#ifndef SimulatedRadio_hpp
+#define SimulatedRadio_hpp
+
+#include "NRF24L01Interface.hpp"
+#include <ucontext.h>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace nRF24L01 {
+
+    class SimulatedRadio;
+
+    /**
+     A packet or an ACK on the air.
+     */
+    struct SimulatedTransmission {
+        unsigned long id;
+        SimulatedRadio *from;
+        // For ACKs: the radio being acknowledged and the id of the transmission the ACK is for.
+        SimulatedRadio *ACKFor;
+        unsigned long ACKOf;
+        unsigned char channel;
+        unsigned char address[5];
+        unsigned char addressWidth;
+        unsigned char payload[32];
+        unsigned char size;
+        bool noACK;
+        unsigned char PID;
+        // On the air (after the radio settled) from start to end, in microseconds.
+        unsigned long long start;
+        unsigned long long end;
+    };
+
+
+    /**
+     The air shared by every simulated radio, and the clock.
+
+     Time only moves when the code under test uses a radio (every SPI byte takes 1us, and so does `micros`) or calls `delay`.
+     The code under test can run in two ways:
+     - In plain threads, which all share one clock. Good for checking that concurrent callers don't break each other.
+     - In processes started with `spawn` and run by `runFor`. Every process keeps its own clock and they take turns, always running
+       the one that's furthest behind, so several nodes can run their own loops (blocking waits and all) and still hear each other on time.
+     */
+    class SimulatedMedium {
+    public:
+        static const unsigned long long NEVER = ~0ULL;
+
+        static SimulatedMedium &shared() {
+            static SimulatedMedium medium;
+            return medium;
+        }
+
+        /**
+         @return The time of the calling process (or thread) in microseconds.
+         */
+        unsigned long long now() const {
+            return _current != 0 ? _current->clock : _clock;
+        }
+
+        /**
+         Lets time pass for the caller. Inside a process this may switch to another process.
+         */
+        void elapse(unsigned long microseconds) {
+            if(_current != 0) {
+                Process *process = _current;
+                process->clock += microseconds;
+                if(process->clock >= _turnEnd) {
+                    swapcontext(&process->context, &_schedulerContext);
+                }
+                // Only run events up to where every other process has got to, so none of them misses anything.
+                advanceTo(process->clock < _othersClock ? process->clock : _othersClock);
+                return;
+            }
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            advanceTo(_clock + microseconds);
+        }
+
+        /**
+         Starts a process. It first runs during the next `runFor`.
+         */
+        void spawn(std::function<void()> body) {
+            Process *process = new Process();
+            process->body = body;
+            process->clock = _clock;
+            process->finished = false;
+            process->stack.resize(STACK_SIZE);
+            getcontext(&process->context);
+            process->context.uc_stack.ss_sp = &process->stack[0];
+            process->context.uc_stack.ss_size = process->stack.size();
+            process->context.uc_link = &_schedulerContext;
+            makecontext(&process->context, &SimulatedMedium::runProcess, 0);
+            _processes.push_back(process);
+        }
+
+        /**
+         Runs the processes for a while. Call this from outside of any process.
+         */
+        void runFor(unsigned long long microseconds) {
+            unsigned long long end = _clock + microseconds;
+            // Time may have moved on outside of the processes (e.g. creating more controllers), and they can't act in the past.
+            for(size_t i = 0; i < _processes.size(); i++) {
+                if(_processes[i]->clock < _clock) {
+                    _processes[i]->clock = _clock;
+                }
+            }
+            while(true) {
+                Process *next = 0;
+                unsigned long long following = end;
+                for(size_t i = 0; i < _processes.size(); i++) {
+                    Process *process = _processes[i];
+                    if(process->finished) {
+                        continue;
+                    }
+                    if(next == 0 || process->clock < next->clock) {
+                        if(next != 0 && next->clock < following) {
+                            following = next->clock;
+                        }
+                        next = process;
+                    } else if(process->clock < following) {
+                        following = process->clock;
+                    }
+                }
+                if(next == 0 || next->clock >= end) {
+                    break;
+                }
+                _othersClock = following;
+                _turnEnd = _othersClock + QUANTUM;
+                _current = next;
+                swapcontext(&_schedulerContext, &next->context);
+                _current = 0;
+            }
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            advanceTo(end);
+        }
+
+        /**
+         Forgets all processes and transmissions. Radios that still exist stay on the air.
+         */
+        void reset() {
+            for(size_t i = 0; i < _processes.size(); i++) {
+                delete _processes[i];
+            }
+            _processes.clear();
+            _transmissions.clear();
+            _range = INFINITY;
+        }
+
+        /**
+         Radios further apart than this can't hear each other. Everything is in range by default.
+         */
+        void setRange(double range) {
+            _range = range;
+        }
+
+        std::recursive_mutex &getMutex() {
+            return _mutex;
+        }
+
+        /**
+         @return Something that identifies the caller, to tell concurrent SPI transactions apart.
+         */
+        const void *getCaller() const {
+            static thread_local char thread;
+            return _current != 0 ? static_cast<const void *>(_current) : static_cast<const void *>(&thread);
+        }
+
+        // Used by the radios
+
+        /**
+         @return The time of the last event, which is when changes made by the caller take effect.
+         */
+        unsigned long long eventTime() const {
+            return _clock;
+        }
+
+        void changed() {
+            _nextEventKnown = false;
+        }
+
+        void addRadio(SimulatedRadio *radio) {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _radios.push_back(radio);
+            changed();
+        }
+
+        void removeRadio(SimulatedRadio *radio) {
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            for(size_t i = 0; i < _radios.size(); i++) {
+                if(_radios[i] == radio) {
+                    _radios.erase(_radios.begin() + i);
+                    break;
+                }
+            }
+            changed();
+        }
+
+        const SimulatedTransmission &addTransmission(SimulatedTransmission transmission) {
+            transmission.id = ++_lastTransmissionID;
+            // Anything that ended a while ago can't overlap with anything new.
+            while(!_transmissions.empty() && _transmissions.front().end + 100000 < _clock) {
+                _transmissions.pop_front();
+            }
+            _transmissions.push_back(transmission);
+            changed();
+            return _transmissions.back();
+        }
+
+        bool inRange(const SimulatedRadio *a, const SimulatedRadio *b) const;
+
+        /**
+         @return `true` if `at` couldn't make out `transmission` because something else was on the air (or `at` was transmitting itself.)
+         */
+        bool collided(const SimulatedTransmission &transmission, const SimulatedRadio *at) const {
+            for(size_t i = 0; i < _transmissions.size(); i++) {
+                const SimulatedTransmission &other = _transmissions[i];
+                if(other.id == transmission.id || other.channel != transmission.channel) {
+                    continue;
+                }
+                if(other.start >= transmission.end || transmission.start >= other.end) {
+                    continue;
+                }
+                if(other.from == at || inRange(other.from, at)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         Hands a finished transmission to every radio that might hear it.
+         */
+        void deliver(const SimulatedTransmission &transmission);
+
+        /**
+         @return `true` if an ACK for transmission `id` reached `radio` intact.
+         */
+        bool receivedACK(const SimulatedRadio *radio, unsigned long id) const {
+            for(size_t i = 0; i < _transmissions.size(); i++) {
+                const SimulatedTransmission &ACK = _transmissions[i];
+                if(ACK.ACKFor == radio && ACK.ACKOf == id && ACK.end <= _clock && !collided(ACK, radio)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+
+        struct Process {
+            ucontext_t context;
+            std::vector<char> stack;
+            std::function<void()> body;
+            unsigned long long clock;
+            bool finished;
+        };
+
+        static const size_t STACK_SIZE = 256 * 1024;
+        // How far a process may run ahead of the others before it has to let them catch up.
+        static const unsigned long long QUANTUM = 10;
+
+        std::recursive_mutex _mutex;
+        unsigned long long _clock;
+        std::vector<SimulatedRadio *> _radios;
+        std::deque<SimulatedTransmission> _transmissions;
+        unsigned long _lastTransmissionID;
+        double _range;
+        unsigned long long _nextEvent;
+        bool _nextEventKnown;
+
+        std::vector<Process *> _processes;
+        Process *_current;
+        ucontext_t _schedulerContext;
+        // The earliest clock of the processes that aren't running
+        unsigned long long _othersClock;
+        unsigned long long _turnEnd;
+
+        SimulatedMedium(): _clock(0), _lastTransmissionID(0), _range(INFINITY), _nextEvent(NEVER), _nextEventKnown(false), _current(0), _othersClock(0), _turnEnd(0) {
+        }
+
+        static void runProcess() {
+            SimulatedMedium &medium = shared();
+            Process *process = medium._current;
+            process->body();
+            process->finished = true;
+        }
+
+        /**
+         Runs every radio event up to `time`, in order.
+         */
+        void advanceTo(unsigned long long time);
+    };
+
+
+    /**
+     A simulated nRF24L01+: the registers, FIFOs and commands the library uses, plus Enhanced ShockBurst timing, ACKs, retransmits and collisions.
+     */
+    class SimulatedRadio {
+    public:
+
+        struct Statistics {
+            // Every packet put on the air, retransmits included
+            unsigned long transmissions;
+            unsigned long retransmits;
+            // Packets that gave up after the last retransmit (MAX_RT)
+            unsigned long packetsLost;
+            unsigned long packetsReceived;
+            // Packets this radio should have received but couldn't make out
+            unsigned long collisions;
+            // Retransmits of packets that were already received
+            unsigned long duplicatesDiscarded;
+            unsigned long RXFIFOFull;
+            unsigned long ACKsSent;
+        };
+
+        SimulatedRadio(SimulatedMedium &medium): _medium(medium), _CE(false), _CEPulse(false), _reuse(false), _TXState(TXState::Idle), _headFlushed(false), _retries(0), _PID(0), _listeningSince(SimulatedMedium::NEVER), _x(0), _y(0), _clockSkewPPM(0), _IRQAsserted(false), _transactionOwner(0), _transactionViolations(0) {
+            for(unsigned char i = 0; i < 0x20; i++) {
+                _registers[i] = 0;
+            }
+            _registers[CONFIG] = 0x08;
+            _registers[EN_AA] = 0x3F;
+            _registers[EN_RXADDR] = 0x03;
+            _registers[SETUP_AW] = 0x03;
+            _registers[SETUP_RETR] = 0x03;
+            _registers[RF_CH] = 0x02;
+            _registers[RF_SETUP] = 0x0E;
+            for(unsigned char i = 0; i < 5; i++) {
+                _RXAddress0[i] = 0xE7;
+                _RXAddress1[i] = 0xC2;
+                _TXAddress[i] = 0xE7;
+            }
+            _registers[RX_ADDR_P2] = 0xC3;
+            _registers[RX_ADDR_P3] = 0xC4;
+            _registers[RX_ADDR_P4] = 0xC5;
+            _registers[RX_ADDR_P5] = 0xC6;
+            for(unsigned char i = 0; i < 6; i++) {
+                _lastPID[i] = 0xFF;
+            }
+            _statistics = Statistics();
+            _medium.addRadio(this);
+        }
+
+        ~SimulatedRadio() {
+            _medium.removeRadio(this);
+        }
+
+        void setPosition(double x, double y = 0) {
+            _x = x;
+            _y = y;
+        }
+        double getX() const {
+            return _x;
+        }
+        double getY() const {
+            return _y;
+        }
+
+        /**
+         Makes this radio's `micros` run fast (positive) or slow (negative) by this many parts per million.
+         */
+        void setClockSkew(long ppm) {
+            _clockSkewPPM = ppm;
+        }
+
+        unsigned long localTime() const {
+            long long now = (long long)_medium.now();
+            return (unsigned long)(now + now * _clockSkewPPM / 1000000);
+        }
+
+        /**
+         Called on the falling edge of the IRQ pin, from inside the simulation. It must not use the radio, only take note (e.g. `notifyInterrupt`.)
+         */
+        void setInterruptHandler(std::function<void()> handler) {
+            _interruptHandler = handler;
+        }
+
+        bool isIRQAsserted() const {
+            return _IRQAsserted;
+        }
+
+        const Statistics &getStatistics() const {
+            return _statistics;
+        }
+
+        /**
+         @return How many times a transaction was started while another caller was in the middle of one.
+         */
+        unsigned long getTransactionViolations() const {
+            return _transactionViolations;
+        }
+
+        // SPI and pins, used by `SimulatedInterface`
+
+        void beginTransaction() {
+            const void *caller = _medium.getCaller();
+            const void *owner = _transactionOwner.load();
+            if(owner != 0 && owner != caller) {
+                _transactionViolations++;
+            }
+            _transactionOwner = caller;
+            std::lock_guard<std::recursive_mutex> lock(_medium.getMutex());
+            _command.clear();
+        }
+
+        unsigned char transfer(unsigned char b) {
+            std::lock_guard<std::recursive_mutex> lock(_medium.getMutex());
+            unsigned char out = _command.empty() ? status() : read((unsigned char)(_command.size() - 1));
+            _command.push_back(b);
+            return out;
+        }
+
+        void endTransaction() {
+            std::lock_guard<std::recursive_mutex> lock(_medium.getMutex());
+            execute();
+            _command.clear();
+            _transactionOwner = 0;
+        }
+
+        void setCE(bool high) {
+            std::lock_guard<std::recursive_mutex> lock(_medium.getMutex());
+            if(high && !_CE) {
+                _CEPulse = true;
+            }
+            _CE = high;
+            updateListening();
+            _medium.changed();
+        }
+
+        // Events, used by `SimulatedMedium`
+
+        unsigned long long nextEvent() const {
+            if(!poweredUp()) {
+                return SimulatedMedium::NEVER;
+            }
+            switch(_TXState) {
+                case TXState::Idle:
+                    return canStartTransmitting() ? 0 : SimulatedMedium::NEVER;
+                case TXState::Sending:
+                    return _transmission.end;
+                case TXState::WaitingForACK:
+                    return _ACKDeadline;
+                case TXState::RetransmitDelay:
+                    return _retransmitAt;
+            }
+            return SimulatedMedium::NEVER;
+        }
+
+        void handleEvent() {
+            unsigned long long now = _medium.eventTime();
+            switch(_TXState) {
+                case TXState::Idle:
+                    startTransmitting(now, true);
+                    break;
+                case TXState::Sending: {
+                    SimulatedTransmission transmission = _transmission;
+                    bool expectsACK = !transmission.noACK && (_registers[EN_AA] & 0x01);
+                    _medium.deliver(transmission);
+                    if(expectsACK) {
+                        _TXState = TXState::WaitingForACK;
+                        _ACKDeadline = transmission.end + SETTLE_MICROSECONDS + airtime(0) + 1;
+                    } else {
+                        succeeded();
+                    }
+                    break;
+                }
+                case TXState::WaitingForACK:
+                    if(_medium.receivedACK(this, _transmission.id)) {
+                        succeeded();
+                    } else {
+                        failedAttempt(now);
+                    }
+                    break;
+                case TXState::RetransmitDelay:
+                    startTransmitting(now, false);
+                    break;
+            }
+            _medium.changed();
+        }
+
+        /**
+         Called for every transmission that ends within range.
+         */
+        void receive(const SimulatedTransmission &transmission) {
+            if(!isListening() || _listeningSince > transmission.start || _registers[RF_CH] != transmission.channel || transmission.addressWidth != addressWidth()) {
+                return;
+            }
+            int pipe = matchPipe(transmission.address);
+            if(pipe < 0) {
+                return;
+            }
+            if(_medium.collided(transmission, this)) {
+                _statistics.collisions++;
+                return;
+            }
+            bool dynamic = (_registers[FEATURE] & 0x04) && (_registers[DYNPD] & (1 << pipe));
+            if(transmission.ACKFor != 0 || (!dynamic && transmission.size != _registers[RX_PW_P0 + pipe])) {
+                // An ACK, or a packet of the wrong length which fails its CRC
+                return;
+            }
+
+            bool ACKRequested = !transmission.noACK && (_registers[EN_AA] & (1 << pipe));
+            unsigned long CRC = checksum(transmission);
+            bool duplicate = ACKRequested && transmission.PID == _lastPID[pipe] && CRC == _lastCRC[pipe];
+            if(duplicate) {
+                _statistics.duplicatesDiscarded++;
+            } else {
+                if(_RXFIFO.size() >= 3) {
+                    // Nothing is acknowledged while the RX FIFO is full.
+                    _statistics.RXFIFOFull++;
+                    return;
+                }
+                RXPacket packet;
+                packet.pipe = (unsigned char)pipe;
+                packet.size = transmission.size;
+                for(unsigned char i = 0; i < transmission.size; i++) {
+                    packet.data[i] = transmission.payload[i];
+                }
+                _RXFIFO.push_back(packet);
+                _lastPID[pipe] = transmission.PID;
+                _lastCRC[pipe] = CRC;
+                _registers[STATUS] |= RX_DR;
+                _statistics.packetsReceived++;
+                updateIRQ();
+            }
+
+            if(ACKRequested) {
+                SimulatedTransmission ACK = SimulatedTransmission();
+                ACK.from = this;
+                ACK.ACKFor = transmission.from;
+                ACK.ACKOf = transmission.id;
+                ACK.channel = transmission.channel;
+                ACK.addressWidth = transmission.addressWidth;
+                for(unsigned char i = 0; i < transmission.addressWidth; i++) {
+                    ACK.address[i] = transmission.address[i];
+                }
+                ACK.size = 0;
+                ACK.noACK = true;
+                ACK.start = transmission.end + SETTLE_MICROSECONDS;
+                ACK.end = ACK.start + airtime(0);
+                _medium.addTransmission(ACK);
+                _statistics.ACKsSent++;
+            }
+        }
+
+    private:
+
+        enum Registers : unsigned char {
+            CONFIG = 0x00,
+            EN_AA = 0x01,
+            EN_RXADDR = 0x02,
+            SETUP_AW = 0x03,
+            SETUP_RETR = 0x04,
+            RF_CH = 0x05,
+            RF_SETUP = 0x06,
+            STATUS = 0x07,
+            OBSERVE_TX = 0x08,
+            RX_ADDR_P0 = 0x0A,
+            RX_ADDR_P1 = 0x0B,
+            RX_ADDR_P2 = 0x0C,
+            RX_ADDR_P3 = 0x0D,
+            RX_ADDR_P4 = 0x0E,
+            RX_ADDR_P5 = 0x0F,
+            TX_ADDR = 0x10,
+            RX_PW_P0 = 0x11,
+            FIFO_STATUS = 0x17,
+            DYNPD = 0x1C,
+            FEATURE = 0x1D
+        };
+
+        enum Bits : unsigned char {
+            PRIM_RX = 1 << 0,
+            PWR_UP = 1 << 1,
+            RX_DR = 1 << 6,
+            TX_DS = 1 << 5,
+            MAX_RT = 1 << 4,
+            INTERRUPTS = RX_DR | TX_DS | MAX_RT
+        };
+
+        enum class TXState : unsigned char {
+            Idle,
+            Sending,
+            WaitingForACK,
+            RetransmitDelay
+        };
+
+        struct TXPacket {
+            unsigned char data[32];
+            unsigned char size;
+            bool noACK;
+        };
+
+        struct RXPacket {
+            unsigned char data[32];
+            unsigned char size;
+            unsigned char pipe;
+        };
+
+        static const unsigned long SETTLE_MICROSECONDS = 130;
+
+        SimulatedMedium &_medium;
+        unsigned char _registers[0x20];
+        unsigned char _RXAddress0[5];
+        unsigned char _RXAddress1[5];
+        unsigned char _TXAddress[5];
+        std::deque<TXPacket> _TXFIFO;
+        std::deque<RXPacket> _RXFIFO;
+        bool _CE;
+        // A rising edge on CE sends a packet even if CE goes low again before it starts.
+        bool _CEPulse;
+        bool _reuse;
+
+        TXState _TXState;
+        SimulatedTransmission _transmission;
+        // FLUSH_TX removed the packet while it was being sent
+        bool _headFlushed;
+        unsigned char _retries;
+        unsigned char _PID;
+        unsigned long long _ACKDeadline;
+        unsigned long long _retransmitAt;
+
+        unsigned long long _listeningSince;
+        unsigned char _lastPID[6];
+        unsigned long _lastCRC[6];
+
+        double _x;
+        double _y;
+        long _clockSkewPPM;
+        std::function<void()> _interruptHandler;
+        bool _IRQAsserted;
+
+        std::vector<unsigned char> _command;
+        std::atomic<const void *> _transactionOwner;
+        std::atomic<unsigned long> _transactionViolations;
+        Statistics _statistics;
+
+        bool poweredUp() const {
+            return (_registers[CONFIG] & PWR_UP) != 0;
+        }
+
+        bool isListening() const {
+            return poweredUp() && (_registers[CONFIG] & PRIM_RX) && _CE;
+        }
+
+        unsigned char addressWidth() const {
+            return (_registers[SETUP_AW] & 0x03) + 2;
+        }
+
+        bool canStartTransmitting() const {
+            return !(_registers[CONFIG] & PRIM_RX) && (_CE || _CEPulse) && !_TXFIFO.empty() && !(_registers[STATUS] & MAX_RT);
+        }
+
+        /**
+         @return Microseconds on the air for a packet with `size` bytes of payload.
+         */
+        unsigned long airtime(unsigned char size) const {
+            unsigned char CRCBytes = (_registers[CONFIG] & 0x08) ? ((_registers[CONFIG] & 0x04) ? 2 : 1) : 0;
+            unsigned long bits = 8UL * (1 + addressWidth() + size + CRCBytes) + 9;
+            if(_registers[RF_SETUP] & 0x20) {
+                return bits * 4;
+            }
+            if(_registers[RF_SETUP] & 0x08) {
+                return (bits + 1) / 2;
+            }
+            return bits;
+        }
+
+        unsigned long checksum(const SimulatedTransmission &transmission) const {
+            unsigned long sum = transmission.size;
+            for(unsigned char i = 0; i < transmission.size; i++) {
+                sum = sum * 31 + transmission.payload[i];
+            }
+            return sum;
+        }
+
+        int matchPipe(const unsigned char address[]) const {
+            unsigned char width = addressWidth();
+            for(unsigned char pipe = 0; pipe < 6; pipe++) {
+                if(!(_registers[EN_RXADDR] & (1 << pipe))) {
+                    continue;
+                }
+                bool matches = true;
+                for(unsigned char i = 0; i < width && matches; i++) {
+                    unsigned char expected;
+                    if(pipe == 0) {
+                        expected = _RXAddress0[i];
+                    } else if(pipe == 1 || i > 0) {
+                        expected = _RXAddress1[i];
+                    } else {
+                        expected = _registers[RX_ADDR_P0 + pipe];
+                    }
+                    matches = expected == address[i];
+                }
+                if(matches) {
+                    return pipe;
+                }
+            }
+            return -1;
+        }
+
+        void startTransmitting(unsigned long long now, bool newPacket) {
+            const TXPacket &packet = _TXFIFO.front();
+            if(newPacket) {
+                _PID = (_PID + 1) & 0x03;
+                _retries = 0;
+                _headFlushed = false;
+                _CEPulse = false;
+            } else {
+                _statistics.retransmits++;
+            }
+            SimulatedTransmission transmission = SimulatedTransmission();
+            transmission.from = this;
+            transmission.channel = _registers[RF_CH];
+            transmission.addressWidth = addressWidth();
+            for(unsigned char i = 0; i < 5; i++) {
+                transmission.address[i] = _TXAddress[i];
+            }
+            transmission.size = packet.size;
+            for(unsigned char i = 0; i < packet.size; i++) {
+                transmission.payload[i] = packet.data[i];
+            }
+            transmission.noACK = packet.noACK;
+            transmission.PID = _PID;
+            transmission.start = now + SETTLE_MICROSECONDS;
+            transmission.end = transmission.start + airtime(packet.size);
+            _transmission = _medium.addTransmission(transmission);
+            _statistics.transmissions++;
+            _TXState = TXState::Sending;
+        }
+
+        void succeeded() {
+            _registers[STATUS] |= TX_DS;
+            _registers[OBSERVE_TX] = (_registers[OBSERVE_TX] & 0xF0) | _retries;
+            if(!_reuse && !_headFlushed && !_TXFIFO.empty()) {
+                _TXFIFO.pop_front();
+            }
+            _TXState = TXState::Idle;
+            updateIRQ();
+        }
+
+        void failedAttempt(unsigned long long now) {
+            if(_headFlushed) {
+                // Nothing left to retransmit
+                _TXState = TXState::Idle;
+                return;
+            }
+            unsigned char retransmitCount = _registers[SETUP_RETR] & 0x0F;
+            if(_retries < retransmitCount) {
+                _retries++;
+                unsigned long long delay = ((_registers[SETUP_RETR] >> 4) + 1) * 250ULL;
+                _retransmitAt = _transmission.end + delay;
+                if(_retransmitAt < now) {
+                    _retransmitAt = now;
+                }
+                _TXState = TXState::RetransmitDelay;
+                return;
+            }
+            _registers[STATUS] |= MAX_RT;
+            if((_registers[OBSERVE_TX] >> 4) < 15) {
+                _registers[OBSERVE_TX] += 0x10;
+            }
+            _statistics.packetsLost++;
+            _TXState = TXState::Idle;
+            updateIRQ();
+        }
+
+        void updateListening() {
+            if(!isListening()) {
+                _listeningSince = SimulatedMedium::NEVER;
+            } else if(_listeningSince == SimulatedMedium::NEVER) {
+                _listeningSince = _medium.eventTime() + SETTLE_MICROSECONDS;
+            }
+        }
+
+        void updateIRQ() {
+            bool asserted = (_registers[STATUS] & INTERRUPTS & ~_registers[CONFIG]) != 0;
+            bool falling = asserted && !_IRQAsserted;
+            _IRQAsserted = asserted;
+            if(falling && _interruptHandler) {
+                _interruptHandler();
+            }
+        }
+
+        unsigned char status() const {
+            unsigned char status = _registers[STATUS] & INTERRUPTS;
+            status |= (_RXFIFO.empty() ? 0x07 : _RXFIFO.front().pipe) << 1;
+            if(_TXFIFO.size() >= 3) {
+                status |= 0x01;
+            }
+            return status;
+        }
+
+        unsigned char FIFOStatus() const {
+            unsigned char fifo = 0;
+            if(_RXFIFO.empty()) {
+                fifo |= 0x01;
+            }
+            if(_RXFIFO.size() >= 3) {
+                fifo |= 0x02;
+            }
+            if(_TXFIFO.empty()) {
+                fifo |= 0x10;
+            }
+            if(_TXFIFO.size() >= 3) {
+                fifo |= 0x20;
+            }
+            if(_reuse) {
+                fifo |= 0x40;
+            }
+            return fifo;
+        }
+
+        unsigned char *addressRegister(unsigned char reg) {
+            switch(reg) {
+                case RX_ADDR_P0:
+                    return _RXAddress0;
+                case RX_ADDR_P1:
+                    return _RXAddress1;
+                case TX_ADDR:
+                    return _TXAddress;
+                default:
+                    return 0;
+            }
+        }
+
+        /**
+         @return The byte clocked out for data byte `index` of the current command.
+         */
+        unsigned char read(unsigned char index) {
+            unsigned char command = _command[0];
+            if((command & 0xE0) == 0x00) {
+                unsigned char reg = command & 0x1F;
+                unsigned char *address = addressRegister(reg);
+                if(address != 0) {
+                    return address[index % 5];
+                }
+                switch(reg) {
+                    case STATUS:
+                        return status();
+                    case FIFO_STATUS:
+                        return FIFOStatus();
+                    default:
+                        return _registers[reg];
+                }
+            }
+            if(command == 0x61) {
+                return (!_RXFIFO.empty() && index < _RXFIFO.front().size) ? _RXFIFO.front().data[index] : 0;
+            }
+            if(command == 0x60) {
+                return _RXFIFO.empty() ? 0 : _RXFIFO.front().size;
+            }
+            return 0;
+        }
+
+        /**
+         Carries out the command once CSN goes high.
+         */
+        void execute() {
+            if(_command.empty()) {
+                return;
+            }
+            unsigned char command = _command[0];
+            unsigned char dataSize = (unsigned char)(_command.size() - 1);
+            if((command & 0xE0) == 0x20) {
+                if(dataSize == 0) {
+                    return;
+                }
+                unsigned char reg = command & 0x1F;
+                unsigned char *address = addressRegister(reg);
+                if(address != 0) {
+                    for(unsigned char i = 0; i < dataSize && i < 5; i++) {
+                        address[i] = _command[i + 1];
+                    }
+                } else if(reg == STATUS) {
+                    _registers[STATUS] &= ~(_command[1] & INTERRUPTS);
+                } else if(reg == RF_CH) {
+                    _registers[RF_CH] = _command[1];
+                    _registers[OBSERVE_TX] &= 0x0F;
+                } else if(reg != FIFO_STATUS && reg != OBSERVE_TX) {
+                    _registers[reg] = _command[1];
+                }
+                if(reg == CONFIG) {
+                    if(!poweredUp() || (_registers[CONFIG] & PRIM_RX)) {
+                        _TXState = TXState::Idle;
+                    }
+                    updateListening();
+                }
+                updateIRQ();
+            } else if(command == 0xA0 || command == 0xB0) {
+                if(_TXFIFO.size() < 3 && dataSize > 0 && dataSize <= 32) {
+                    TXPacket packet;
+                    packet.size = dataSize;
+                    packet.noACK = command == 0xB0;
+                    for(unsigned char i = 0; i < dataSize; i++) {
+                        packet.data[i] = _command[i + 1];
+                    }
+                    _TXFIFO.push_back(packet);
+                }
+                _reuse = false;
+            } else if(command == 0x61) {
+                if(dataSize > 0 && !_RXFIFO.empty()) {
+                    _RXFIFO.pop_front();
+                }
+            } else if(command == 0xE1) {
+                _TXFIFO.clear();
+                _reuse = false;
+                if(_TXState == TXState::RetransmitDelay) {
+                    _TXState = TXState::Idle;
+                } else if(_TXState != TXState::Idle) {
+                    _headFlushed = true;
+                }
+            } else if(command == 0xE2) {
+                _RXFIFO.clear();
+            } else if(command == 0xE3) {
+                _reuse = true;
+            }
+            _medium.changed();
+        }
+    };
+
+
+    inline bool SimulatedMedium::inRange(const SimulatedRadio *a, const SimulatedRadio *b) const {
+        if(std::isinf(_range)) {
+            return true;
+        }
+        double dx = a->getX() - b->getX();
+        double dy = a->getY() - b->getY();
+        return dx * dx + dy * dy <= _range * _range;
+    }
+
+    inline void SimulatedMedium::deliver(const SimulatedTransmission &transmission) {
+        for(size_t i = 0; i < _radios.size(); i++) {
+            SimulatedRadio *radio = _radios[i];
+            if(radio != transmission.from && inRange(transmission.from, radio)) {
+                radio->receive(transmission);
+            }
+        }
+    }
+
+    inline void SimulatedMedium::advanceTo(unsigned long long time) {
+        while(true) {
+            if(!_nextEventKnown) {
+                _nextEvent = NEVER;
+                for(size_t i = 0; i < _radios.size(); i++) {
+                    unsigned long long event = _radios[i]->nextEvent();
+                    if(event < _nextEvent) {
+                        _nextEvent = event;
+                    }
+                }
+                _nextEventKnown = true;
+            }
+            if(_nextEvent > time) {
+                break;
+            }
+            if(_nextEvent > _clock) {
+                _clock = _nextEvent;
+            }
+            // Handle the first radio with an event due, then look again since it may have changed what the others do.
+            for(size_t i = 0; i < _radios.size(); i++) {
+                if(_radios[i]->nextEvent() <= _clock) {
+                    _radios[i]->handleEvent();
+                    break;
+                }
+            }
+            _nextEventKnown = false;
+        }
+        if(time > _clock) {
+            _clock = time;
+        }
+    }
+
+
+    /**
+     An `NRF24L01Interface` backed by a `SimulatedRadio` on the shared medium, for running the library on a host.
+     */
+    class SimulatedInterface : public NRF24L01Interface {
+    public:
+        SimulatedInterface(SpecialPinHolder *s): NRF24L01Interface(s), _medium(SimulatedMedium::shared()), _radio(new SimulatedRadio(_medium)) {
+        }
+        ~SimulatedInterface() {
+            delete _radio;
+        }
+
+        SimulatedRadio *getRadio() const {
+            return _radio;
+        }
+
+        void begin() {}
+        void end() {}
+
+        // CSN follows the transaction, as in ArduinoInterface, so CountingInterface counts the same toggles.
+        void beginTransaction() {
+            writeCSNLow();
+            _radio->beginTransaction();
+        }
+        void endTransaction() {
+            _radio->endTransaction();
+            writeCSNHigh();
+        }
+
+        // SPI runs at 8MHz, so every byte takes 1us.
+        unsigned char transferByte(unsigned char b) {
+            return transfer(b);
+        }
+        void transferBytes(unsigned char **b, unsigned char size) {
+            for(unsigned char i = 0; i < size; i++) {
+                (*b)[i] = transfer((*b)[i]);
+            }
+        }
+
+        void delay(unsigned int d) {
+            _medium.elapse(d * 1000UL);
+        }
+        void delayMicroseconds(unsigned int d) {
+            _medium.elapse(d);
+        }
+        unsigned long micros() {
+            _medium.elapse(1);
+            return _radio->localTime();
+        }
+
+        void writeCSNHigh() {}
+        void writeCSNLow() {}
+        void writeCEHigh() {
+            _radio->setCE(true);
+        }
+        void writeCELow() {
+            _radio->setCE(false);
+        }
+
+        /**
+         Called whenever `tryLockBus` finds the bus taken, before it returns. Holding the caller there stands in for a slow
+         interrupt or a thread that gets preempted, to let the owner get on with letting go of the bus.
+         */
+        void setBusBusyHandler(std::function<void()> handler) {
+            _busBusyHandler = handler;
+        }
+
+        bool tryLockBus() {
+            if(_busMutex.try_lock()) {
+                return true;
+            }
+            if(_busBusyHandler) {
+                _busBusyHandler();
+            }
+            return false;
+        }
+        void lockBus() {
+            _busMutex.lock();
+        }
+        void unlockBus() {
+            _busMutex.unlock();
+        }
+        void enterCritical() {
+            _criticalMutex.lock();
+        }
+        void exitCritical() {
+            _criticalMutex.unlock();
+        }
+
+    private:
+        SimulatedMedium &_medium;
+        SimulatedRadio *_radio;
+        std::recursive_mutex _busMutex;
+        std::mutex _criticalMutex;
+        std::function<void()> _busBusyHandler;
+
+        // Not virtual, so wrappers like `CountingInterface` don't count bytes twice.
+        unsigned char transfer(unsigned char b) {
+            _medium.elapse(1);
+            return _radio->transfer(b);
+        }
+    };
+}
+
+#endif /* SimulatedRadio_hpp */
@@ -0,0 +1,266 @@
+//
+//  StressTest.cpp
+//
+//  One controller shared by several threads at once: an "interrupt" thread handing its work to `submit`, a loop
+//  reading packets, and two threads changing settings, while another radio keeps sending to it. Checks that no SPI
+//  transactions interleave, no submitted work gets stuck, no setting is lost and every packet arrives intact and in order.
+//  A second run has threads only submitting work and making single calls, including one that queues its work just after
+//  the owner let go of the bus, with nobody calling in afterwards, and checks that nothing is left in the queue once they're done.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+#include <cstring>
+#include <thread>
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> SimulatedController;
+
+static const unsigned long PACKETS = 2000;
+static const unsigned int CONFIG_ROUNDS = 2000;
+static const unsigned char QUIET_THREADS = 4;
+static const unsigned int QUIET_ROUNDS = 5000;
+
+static unsigned char address[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+
+static std::atomic<bool> interruptPending(false);
+static std::atomic<bool> stopping(false);
+static std::atomic<unsigned long> workSubmitted(0);
+static std::atomic<unsigned long> workRun(0);
+
+// Only touched by work, which always owns the bus, so they need no lock of their own.
+static unsigned long received = 0;
+static unsigned long outOfOrder = 0;
+static unsigned long corrupted = 0;
+
+static void fill(unsigned char *data, unsigned long sequence) {
+    for(unsigned char i = 0; i < 32; i++) {
+        data[i] = i < 4 ? (sequence >> (8 * i)) & 0xFF : (sequence + i) & 0xFF;
+    }
+}
+
+static void readPackets(SimulatedController *controller, void *context) {
+    workRun++;
+    while(controller->dataInRXFIFO()) {
+        unsigned char data[32];
+        controller->readData(data, controller->getNextPacketSize());
+        unsigned long sequence = 0;
+        for(unsigned char i = 0; i < 4; i++) {
+            sequence |= (unsigned long)data[i] << (8 * i);
+        }
+        unsigned char expected[32];
+        fill(expected, sequence);
+        if(memcmp(data, expected, 32) != 0) {
+            corrupted++;
+        } else if(sequence != received) {
+            outOfOrder++;
+        }
+        received++;
+    }
+}
+
+static void handleInterrupt(SimulatedController *controller, void *context) {
+    if(controller->readAndClearInterruptBits() & SimulatedController::INTERRUPT_BIT_RX_DR) {
+        readPackets(controller, context);
+    } else {
+        workRun++;
+    }
+}
+
+static void submit(SimulatedController *n, SimulatedController::Work work) {
+    if(n->submit(work)) {
+        workSubmitted++;
+    }
+}
+
+static std::atomic<unsigned long> quietSubmitted(0);
+static std::atomic<unsigned long> quietRun(0);
+static std::atomic<bool> holding(false);
+static std::atomic<bool> contended(false);
+static std::atomic<bool> released(false);
+
+static void countQuietWork(SimulatedController *controller, void *context) {
+    quietRun++;
+}
+
+// Keeps the bus until another thread has found it taken.
+static void holdBus(SimulatedController *controller, void *context) {
+    quietRun++;
+    holding = true;
+    while(!contended) {
+        std::this_thread::yield();
+    }
+}
+
+static void quietSubmit(SimulatedController *n, SimulatedController::Work work) {
+    if(n->submit(work)) {
+        quietSubmitted++;
+    }
+}
+
+/**
+ Threads submitting work and then going quiet, with nobody calling in afterwards to pick up what's left in the queue.
+ First one thread finds the bus taken and only queues its work after the owner has already let go, then several threads
+ submit work between single calls at once.
+
+ @return The number of pieces of work that were accepted but never ran, added up over both.
+ */
+static unsigned long runQuiet() {
+    SimulatedController *n = new SimulatedController(8, 2, 10);
+    n->setPoweredUp(true);
+    SimulatedInterface *interface = n->getInterface();
+
+    interface->setBusBusyHandler([]() {
+        contended = true;
+        while(!released) {
+            std::this_thread::yield();
+        }
+    });
+    std::thread owner([n]() {
+        quietSubmit(n, holdBus);
+        released = true;
+    });
+    std::thread late([n]() {
+        while(!holding) {
+            std::this_thread::yield();
+        }
+        quietSubmit(n, countQuietWork);
+    });
+    owner.join();
+    late.join();
+    // Nothing touches the controller anymore, so whatever is still queued is stuck for good.
+    unsigned long stuck = quietSubmitted - quietRun;
+
+    interface->setBusBusyHandler([]() { std::this_thread::yield(); });
+    std::thread threads[QUIET_THREADS];
+    for(unsigned char i = 0; i < QUIET_THREADS; i++) {
+        threads[i] = std::thread([n]() {
+            for(unsigned int round = 0; round < QUIET_ROUNDS; round++) {
+                n->getFIFOStatus();
+                quietSubmit(n, countQuietWork);
+            }
+        });
+    }
+    for(unsigned char i = 0; i < QUIET_THREADS; i++) {
+        threads[i].join();
+    }
+
+    stuck += quietSubmitted - quietRun;
+    delete n;
+    return stuck;
+}
+
+int main() {
+    SimulatedController *receiver = new SimulatedController(8, 2, 10);
+    receiver->setPoweredUp(true);
+    receiver->setBitrate(2);
+    receiver->setUsesDynamicPayloadLength(false);
+    receiver->setReceivedPacketLength(32);
+    receiver->setPrimaryReceiver();
+    receiver->setAddress(address, 5);
+    // The simulation calls this with its own lock held, so like a real interrupt it only takes note.
+    receiver->getInterface()->getRadio()->setInterruptHandler([]() { interruptPending = true; });
+
+    SimulatedController *sender = new SimulatedController(8, 2, 10);
+    sender->setPoweredUp(true);
+    sender->setBitrate(2);
+    sender->setUsesDynamicPayloadLength(false);
+    sender->setAutoRetransmitCount(15);
+    sender->setPrimaryTransmitter();
+    sender->setAddress(address, 5);
+
+    unsigned long maxRetries = 0;
+    std::thread sending([sender, &maxRetries]() {
+        for(unsigned long sequence = 0; sequence < PACKETS; sequence++) {
+            // Sends again until the receiver has room, so nothing is skipped.
+            while(true) {
+                // Sending overwrites the buffer with what comes back over SPI.
+                unsigned char data[32];
+                fill(data, sequence);
+                sender->startSendingPacket(data, 32);
+                const unsigned char done = SimulatedController::INTERRUPT_BIT_TX_DS | SimulatedController::INTERRUPT_BIT_MAX_RT;
+                unsigned char status;
+                do {
+                    status = sender->getStatusAndConfigRegisters() >> 8;
+                } while((status & done) == 0);
+                // Clearing MAX_RT with CE still high would send the failed packet again, so stop and flush first.
+                sender->concludeSendingPacket();
+                if(status & SimulatedController::INTERRUPT_BIT_MAX_RT) {
+                    sender->flushTXFIFO();
+                }
+                sender->readAndClearInterruptBits();
+                if(status & SimulatedController::INTERRUPT_BIT_TX_DS) {
+                    break;
+                }
+                maxRetries++;
+            }
+        }
+    });
+
+    std::thread interrupts([receiver]() {
+        while(!stopping) {
+            if(interruptPending.exchange(false)) {
+                submit(receiver, handleInterrupt);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Picks up packets whose interrupt was masked, like the Receiver example's loop.
+    std::thread loop([receiver]() {
+        while(!stopping) {
+            submit(receiver, readPackets);
+            receiver->getFIFOStatus();
+            std::this_thread::yield();
+        }
+    });
+
+    // Both change CONFIG, so a read-modify-write cut in half would undo the other one's change.
+    std::thread masking([receiver]() {
+        for(unsigned int i = 0; i < CONFIG_ROUNDS; i++) {
+            receiver->setIRQMode(i % 2 == 0 ? SimulatedController::IRQMode::Polling : SimulatedController::IRQMode::Interrupt);
+        }
+    });
+    std::thread configuring([receiver]() {
+        for(unsigned int i = 0; i < CONFIG_ROUNDS; i++) {
+            receiver->setCRCEnabled(true);
+            receiver->setChannel(2);
+            receiver->setAutoRetransmitCount(i % 16);
+            receiver->getStatusAndConfigRegisters();
+        }
+    });
+
+    sending.join();
+    masking.join();
+    configuring.join();
+    // Let the loop pick up the last packets.
+    while(receiver->dataInRXFIFO());
+    stopping = true;
+    interrupts.join();
+    loop.join();
+
+    unsigned char config = receiver->getStatusAndConfigRegisters() & 0xFF;
+    // The last setIRQMode call chose Interrupt, so nothing is masked. CRC, power and PRIM_RX must all have survived.
+    const unsigned char expected = 0x08 | 0x02 | 0x01;
+    unsigned long violations = receiver->getInterface()->getRadio()->getTransactionViolations() + sender->getInterface()->getRadio()->getTransactionViolations();
+
+    printf("Stress: %lu packets to a controller shared by 4 threads, %u rounds of setting changes\n", PACKETS, CONFIG_ROUNDS);
+    printf("received %lu, out of order %lu, corrupted %lu, resent after max retries %lu\n", received, outOfOrder, corrupted, maxRetries);
+    printf("work submitted %lu, run %lu, interleaved transactions %lu, CONFIG 0x%02X (expected 0x%02X)\n", workSubmitted.load(), workRun.load(), violations, config, expected);
+
+    check(violations == 0, "no SPI transactions interleave");
+    check(workRun == workSubmitted, "every piece of work that was accepted ran");
+    check(received == PACKETS && outOfOrder == 0 && corrupted == 0, "every packet arrives once, intact and in order");
+    check((config & 0x7F) == expected, "no change to CONFIG is lost");
+
+    unsigned long stuck = runQuiet();
+    printf("Quiet: %u threads submitting work %u times each, work submitted %lu, left in the queue %lu\n", QUIET_THREADS, QUIET_ROUNDS, quietSubmitted.load(), stuck);
+    check(stuck == 0, "no work is left in the queue once every thread goes quiet");
+
+    delete receiver;
+    delete sender;
+    return failures();
+}
@@ -0,0 +1,281 @@
+//
+//  TDMATest.cpp
+//
+//  Several nodes sending to one gateway as fast as they can, once on their own with auto retransmit and once under TDMA.
+//  Reports how the total throughput scales with the number of nodes, and checks that TDMA nodes never collide
+//  or acknowledge each other's packets. Also checks that a node recovers after the gateway stops acknowledging for a while.
+//
+
+#include "SimulatedRadio.hpp"
+#include "Check.hpp"
+#include "nRF24L01.hpp"
+#include "TDMA.hpp"
+
+using namespace nRF24L01;
+
+typedef Controller<SimulatedInterface> SimulatedController;
+
+static const unsigned long long RUN_MICROSECONDS = 2000000;
+static const unsigned int SLOT_MICROSECONDS = 4000;
+static const unsigned char MAX_NODES = 12;
+// The gateway stops reading its RX FIFO, and so stops acknowledging, from STALL_START for STALL_MICROSECONDS.
+static const unsigned long STALL_START = 500000;
+static const unsigned long STALL_MICROSECONDS = 100000;
+static const unsigned long WINDOW_MICROSECONDS = 100000;
+static const unsigned char WINDOWS = RUN_MICROSECONDS / WINDOW_MICROSECONDS;
+
+struct Result {
+    unsigned long received;
+    unsigned long receivedPerNode[MAX_NODES + 1];
+    unsigned long transmissions;
+    unsigned long packetsLost;
+    // ACKs sent by nodes, which can only be for other nodes' packets
+    unsigned long nodeACKs;
+    unsigned long gatewayCollisions;
+    bool synchronized;
+};
+
+static unsigned char address[] = {0x12, 0x34, 0x56, 0x78, 0x9A};
+static unsigned char beaconAddress[] = {0x13, 0x34, 0x56, 0x78, 0x9A};
+
+static SimulatedController *makeController() {
+    SimulatedController *n = new SimulatedController(8, 2, 10);
+    n->setPoweredUp(true);
+    n->setBitrate(2);
+    n->setAutoAcknowledgementEnabled(true);
+    return n;
+}
+
+static void receive(SimulatedController *gateway, Result &result) {
+    while(gateway->dataInRXFIFO()) {
+        unsigned char data[TDMABeacon::SIZE];
+        gateway->readData(data, TDMABeacon::SIZE);
+        if(data[0] >= 1 && data[0] <= MAX_NODES) {
+            result.received++;
+            result.receivedPerNode[data[0]]++;
+        }
+    }
+}
+
+/**
+ Every node sends back to back with up to 15 retransmits, without any coordination.
+ */
+static void runUncoordinated(unsigned char nodeCount, SimulatedController *gateway, SimulatedController **nodes, Result &result) {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    gateway->setUsesDynamicPayloadLength(false);
+    gateway->setReceivedPacketLength(TDMABeacon::SIZE);
+    gateway->setPrimaryTransmitter();
+    gateway->setAddress(address, 5);
+    gateway->setPrimaryReceiver();
+    medium.spawn([gateway, &result]() {
+        while(true) {
+            receive(gateway, result);
+            gateway->getInterface()->delayMicroseconds(20);
+        }
+    });
+
+    for(unsigned char i = 0; i < nodeCount; i++) {
+        SimulatedController *n = nodes[i];
+        unsigned char id = i + 1;
+        n->setUsesDynamicPayloadLength(false);
+        n->setAutoRetransmitCount(15);
+        n->setPrimaryTransmitter();
+        n->setAddress(address, 5);
+        medium.spawn([n, id]() {
+            // A little jitter between packets, as from a real loop, so the nodes don't stay in lockstep.
+            unsigned long seed = id;
+            while(true) {
+                seed = seed * 1103515245 + 12345;
+                n->getInterface()->delayMicroseconds((seed >> 16) % 1000);
+                unsigned char packet[TDMABeacon::SIZE] = {id};
+                n->sendPacketAndWait(packet, TDMABeacon::SIZE);
+            }
+        });
+    }
+}
+
+static void runTDMA(unsigned char nodeCount, SimulatedController *gateway, SimulatedController **nodes, Result &result, TDMAGateway<SimulatedInterface> *&tdmaGateway, TDMANode<SimulatedInterface> **tdmaNodes) {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    tdmaGateway = new TDMAGateway<SimulatedInterface>(gateway, SLOT_MICROSECONDS);
+    for(unsigned char i = 0; i < nodeCount; i++) {
+        tdmaGateway->assignSlot(i, i + 1);
+    }
+    tdmaGateway->begin(address, beaconAddress, 5);
+    TDMAGateway<SimulatedInterface> *g = tdmaGateway;
+    medium.spawn([gateway, g, &result]() {
+        while(true) {
+            g->poll();
+            receive(gateway, result);
+            gateway->getInterface()->delayMicroseconds(20);
+        }
+    });
+
+    for(unsigned char i = 0; i < nodeCount; i++) {
+        SimulatedController *n = nodes[i];
+        unsigned char id = i + 1;
+        // Crystals are off by up to 100ppm either way.
+        n->getInterface()->getRadio()->setClockSkew((i % 2 == 0 ? 1 : -1) * (long)(10 + 8 * i));
+        n->setAutoRetransmitCount(2);
+        TDMANode<SimulatedInterface> *node = new TDMANode<SimulatedInterface>(n, id);
+        node->begin(address, beaconAddress, 5);
+        tdmaNodes[i] = node;
+        medium.spawn([n, node, id]() {
+            while(true) {
+                node->poll();
+                unsigned char packet[1] = {id};
+                node->send(packet, 1);
+                n->getInterface()->delayMicroseconds(20);
+            }
+        });
+    }
+}
+
+static Result run(bool useTDMA, unsigned char nodeCount) {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    medium.reset();
+    Result result = Result();
+
+    SimulatedController *gateway = makeController();
+    SimulatedController *nodes[MAX_NODES];
+    for(unsigned char i = 0; i < nodeCount; i++) {
+        nodes[i] = makeController();
+    }
+    TDMAGateway<SimulatedInterface> *tdmaGateway = 0;
+    TDMANode<SimulatedInterface> *tdmaNodes[MAX_NODES];
+    if(useTDMA) {
+        runTDMA(nodeCount, gateway, nodes, result, tdmaGateway, tdmaNodes);
+    } else {
+        runUncoordinated(nodeCount, gateway, nodes, result);
+    }
+
+    medium.runFor(RUN_MICROSECONDS);
+
+    result.synchronized = true;
+    for(unsigned char i = 0; i < nodeCount; i++) {
+        const SimulatedRadio::Statistics &stats = nodes[i]->getInterface()->getRadio()->getStatistics();
+        result.transmissions += stats.transmissions;
+        result.packetsLost += stats.packetsLost;
+        result.nodeACKs += stats.ACKsSent;
+        if(useTDMA) {
+            result.synchronized = result.synchronized && tdmaNodes[i]->isSynchronized();
+        }
+    }
+    result.gatewayCollisions = gateway->getInterface()->getRadio()->getStatistics().collisions;
+
+    // The processes never return, so forget them before their radios go away.
+    medium.reset();
+    for(unsigned char i = 0; i < nodeCount; i++) {
+        if(useTDMA) {
+            delete tdmaNodes[i];
+        }
+        delete nodes[i];
+    }
+    delete tdmaGateway;
+    delete gateway;
+    return result;
+}
+
+/**
+ One TDMA node sending as fast as it can with 15 retransmits, while the gateway stops acknowledging for a while.
+ Fills in how many packets arrived in each window of the run.
+ */
+static void runStall(unsigned long received[WINDOWS]) {
+    SimulatedMedium &medium = SimulatedMedium::shared();
+    medium.reset();
+
+    SimulatedController *gateway = makeController();
+    SimulatedController *n = makeController();
+    TDMAGateway<SimulatedInterface> *tdmaGateway = new TDMAGateway<SimulatedInterface>(gateway, SLOT_MICROSECONDS);
+    tdmaGateway->assignSlot(0, 1);
+    tdmaGateway->begin(address, beaconAddress, 5);
+    unsigned long start = gateway->getInterface()->micros();
+    medium.spawn([gateway, tdmaGateway, start, received]() {
+        Result result = Result();
+        while(true) {
+            tdmaGateway->poll();
+            unsigned long elapsed = gateway->getInterface()->micros() - start;
+            if(elapsed < STALL_START || elapsed >= STALL_START + STALL_MICROSECONDS) {
+                unsigned long before = result.received;
+                receive(gateway, result);
+                if(elapsed / WINDOW_MICROSECONDS < WINDOWS) {
+                    received[elapsed / WINDOW_MICROSECONDS] += result.received - before;
+                }
+            }
+            gateway->getInterface()->delayMicroseconds(20);
+        }
+    });
+
+    n->setAutoRetransmitCount(15);
+    TDMANode<SimulatedInterface> *node = new TDMANode<SimulatedInterface>(n, 1);
+    node->begin(address, beaconAddress, 5);
+    medium.spawn([n, node]() {
+        while(true) {
+            node->poll();
+            unsigned char packet[1] = {1};
+            node->send(packet, 1);
+            n->getInterface()->delayMicroseconds(20);
+        }
+    });
+
+    medium.runFor(RUN_MICROSECONDS);
+
+    medium.reset();
+    delete node;
+    delete n;
+    delete tdmaGateway;
+    delete gateway;
+}
+
+int main() {
+    const unsigned char counts[] = {1, 2, 4, 8, 12};
+    const unsigned char runs = sizeof(counts);
+    Result uncoordinated[runs];
+    Result tdma[runs];
+
+    printf("TDMA: nodes sending to one gateway as fast as they can, %lums slots, 2Mbps\n", (unsigned long)SLOT_MICROSECONDS / 1000);
+    printf("nodes  scheme          packets/s  transmissions/packet  lost  ACKs from nodes  collisions at gateway\n");
+    for(unsigned char r = 0; r < runs; r++) {
+        for(unsigned char scheme = 0; scheme < 2; scheme++) {
+            Result result = run(scheme == 1, counts[r]);
+            (scheme == 1 ? tdma : uncoordinated)[r] = result;
+            double perSecond = result.received * 1000000.0 / RUN_MICROSECONDS;
+            double perPacket = result.received > 0 ? (double)result.transmissions / result.received : 0;
+            printf("%5u  %-13s  %10.0f  %20.2f  %4lu  %15lu  %21lu\n", counts[r], scheme == 1 ? "TDMA" : "uncoordinated", perSecond, perPacket, result.packetsLost, result.nodeACKs, result.gatewayCollisions);
+        }
+    }
+
+    bool synchronized = true;
+    bool quiet = true;
+    bool fair = true;
+    for(unsigned char r = 0; r < runs; r++) {
+        const Result &result = tdma[r];
+        synchronized = synchronized && result.synchronized;
+        quiet = quiet && result.nodeACKs == 0 && result.gatewayCollisions == 0 && result.packetsLost == 0;
+        for(unsigned char id = 1; id <= counts[r]; id++) {
+            // Every node gets its share of the frame.
+            fair = fair && result.receivedPerNode[id] * counts[r] * 2 >= result.received;
+        }
+    }
+    check(synchronized, "every TDMA node follows the gateway's schedule");
+    check(quiet, "TDMA nodes never collide, lose a packet or acknowledge each other's packets");
+    check(fair, "every TDMA node gets at least half of its share");
+    // A frame grows by a slot per node, so the total throughput should hold up as nodes are added.
+    check(tdma[runs - 1].received * 10 >= tdma[1].received * 8, "TDMA keeps at least 80% of its 2 node throughput with 12 nodes");
+    check(tdma[runs - 1].received > uncoordinated[runs - 1].received, "TDMA beats uncoordinated sending with 12 nodes");
+
+    unsigned long received[WINDOWS] = {0};
+    runStall(received);
+    printf("TDMA: 1 node, the gateway stops acknowledging for %lums after %lums, packets per %lums:", STALL_MICROSECONDS / 1000, STALL_START / 1000, WINDOW_MICROSECONDS / 1000);
+    for(unsigned char i = 0; i < WINDOWS; i++) {
+        printf(" %lu", received[i]);
+    }
+    printf("\n");
+    // The first window includes waiting for the first beacon.
+    unsigned long before = received[STALL_START / WINDOW_MICROSECONDS - 1];
+    bool recovered = before > 0;
+    for(unsigned char i = (STALL_START + STALL_MICROSECONDS) / WINDOW_MICROSECONDS + 1; i < WINDOWS; i++) {
+        recovered = recovered && received[i] * 10 >= before * 9;
+    }
+    check(recovered, "a TDMA node gets back to its full throughput after the gateway stops acknowledging for a while");
+    return failures();
+}
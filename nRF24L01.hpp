@@ -24,7 +24,7 @@ namespace nRF24L01 {
          @param CSNPin The chip select not pin (also called the SS or slave select pin.) This pin is used by SPI to enable the nRF when it wants to send/receive data through SPI.
          @return An instance of `Controller`.
          */
-        Controller(unsigned char CEPin, unsigned char IRQPin, unsigned char CSNPin = 10): _CEPin(CEPin), _IRQPin(IRQPin), _CSNPin(CSNPin), _poweredUp(false), _mode(Mode::None), _ACKEnabled(true), _lastInterruptBits(0) {
+        Controller(unsigned char CEPin, unsigned char IRQPin, unsigned char CSNPin = 10): _poweredUp(false), _IRQPin(IRQPin), _CSNPin(CSNPin), _CEPin(CEPin), _lastInterruptBits(0), _mode(Mode::None), _ACKEnabled(true), _interruptPending(false), _IRQMode(IRQMode::Interrupt), _busyPolling(false), _idlePolls(0), _idlePollThreshold(100), _idlePollInterval(1000), _lastPoll(0), _TXReuseActive(false), _repeatForever(false), _repeatsRemaining(0), _addressWidth(0), _TXAddressKnown(false), _RXAddressKnown(false), _workHead(0), _workCount(0), _busDepth(0) {
             _NRF24L01Interface = new T(static_cast<SpecialPinHolder*>(this));
             // Wait for radio to power on.
             _NRF24L01Interface->delay(100);
@@ -44,6 +44,7 @@ namespace nRF24L01 {
          @param shouldPowerUp `true` to power up or `false` to power down.
          */
         void setPoweredUp(bool shouldPowerUp) {
+            BusLock lock(this);
             if(shouldPowerUp) {
                 if(!_poweredUp) {
                     // Power up the transceiver
@@ -97,6 +98,7 @@ namespace nRF24L01 {
          Sets this transceiver as a primary transmitter.
          */
         void setPrimaryTransmitter() {
+            BusLock lock(this);
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::CONFIG);
             unsigned char config = _NRF24L01Interface->transferByte(Commands::NOP);
@@ -116,6 +118,7 @@ namespace nRF24L01 {
          Sets this transceiver as a primary receiver.
          */
         void setPrimaryReceiver() {
+            BusLock lock(this);
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::CONFIG);
             unsigned char config = _NRF24L01Interface->transferByte(Commands::NOP);
@@ -141,6 +144,7 @@ namespace nRF24L01 {
          @param enabled `true` to enable or `false` to disable.
          */
         void setAutoAcknowledgementEnabled(bool enabled) {
+            BusLock lock(this);
             
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::EN_AA);
@@ -156,6 +160,7 @@ namespace nRF24L01 {
          @param uses `true` to enable, `false` to disable
          */
         void setUsesDynamicPayloadLength(bool uses) {
+            BusLock lock(this);
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::DYNPD);
             _NRF24L01Interface->transferByte(uses ? Bits::DPL_P : 0x00);
@@ -172,6 +177,26 @@ namespace nRF24L01 {
             _NRF24L01Interface->transferByte( uses ? feature | Bits::EN_DPL : (feature & (~Bits::EN_DPL) ) );
             _NRF24L01Interface->endTransaction();
         }
+
+
+        /**
+         Enable or disable dynamic ACK, which allows single packets to be sent without an ACK (see the `noACK` parameter of `startSendingPacket`.)
+
+         @param enabled `true` to enable or `false` to disable.
+         */
+        void setDynamicACKEnabled(bool enabled) {
+            BusLock lock(this);
+            // Read the feature register
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::FEATURE);
+            unsigned char feature = _NRF24L01Interface->transferByte(0x00);
+            _NRF24L01Interface->endTransaction();
+
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::FEATURE);
+            _NRF24L01Interface->transferByte( enabled ? feature | Bits::EN_DYN_ACK : (feature & (~Bits::EN_DYN_ACK) ) );
+            _NRF24L01Interface->endTransaction();
+        }
         
         
         /**
@@ -180,6 +205,7 @@ namespace nRF24L01 {
          @param numberBytes The number of bytes that this receiver should receive each time from the transmitter.
          */
         void setReceivedPacketLength(unsigned char numberBytes) {
+            BusLock lock(this);
             _receivedPacketLength = numberBytes & 0b00111111;
             
             _NRF24L01Interface->beginTransaction();
@@ -191,76 +217,63 @@ namespace nRF24L01 {
         
         /**
          Sets the internal address of the transceiver. A transmitter and receiver should have the same address.
+         The last address written to each register is remembered, so setting the same address again costs nothing
+         and switching between addresses that share their last bytes only writes the bytes that changed.
 
          @param address 3-5 bytes
          @param addressSize The number of bytes in the address
+         @return `true` if anything had to be written, `false` if the nRF already had this address.
          */
-        void setAddress(unsigned char address[], unsigned char addressSize) {
-            unsigned char storage[5];
-            unsigned char *tempAddress = storage;
+        bool setAddress(unsigned char address[], unsigned char addressSize) {
+            BusLock lock(this);
             
             //SETUP_AW
             unsigned char newAddressSize = 0b11;
+            unsigned char width = 5;
             switch(addressSize) {
                 case 3:
                     newAddressSize = 0b01;
+                    width = 3;
                     break;
                 case 4:
                     newAddressSize = 0b10;
+                    width = 4;
                     break;
                 case 5:
                 default:
                     newAddressSize = 0b11;
+                    width = 5;
                     break;
             }
             
-            _NRF24L01Interface->beginTransaction();
-            _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::SETUP_AW);
-            _NRF24L01Interface->transferByte(newAddressSize);
-            _NRF24L01Interface->endTransaction();
+            bool wrote = false;
+            if(width != _addressWidth) {
+                wrote = true;
+                _NRF24L01Interface->beginTransaction();
+                _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::SETUP_AW);
+                _NRF24L01Interface->transferByte(newAddressSize);
+                _NRF24L01Interface->endTransaction();
+                
+                _addressWidth = width;
+                _TXAddressKnown = false;
+                _RXAddressKnown = false;
+            }
             
             switch(_mode) {
                 case Mode::PTX: {
-                    // TODO: Change the address length register
-                   
-                    storage[0] = address[0];
-                    storage[1] = address[1];
-                    storage[2] = address[2];
-                    storage[3] = address[3];
-                    storage[4] = address[4];
-                    
-                    _NRF24L01Interface->beginTransaction();
-                    _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::TX_ADDR);
-                    _NRF24L01Interface->transferBytes(&tempAddress, addressSize);
-                    _NRF24L01Interface->endTransaction();
-                    
-                    storage[0] = address[0];
-                    storage[1] = address[1];
-                    storage[2] = address[2];
-                    storage[3] = address[3];
-                    storage[4] = address[4];
-                    _NRF24L01Interface->beginTransaction();
-                    _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::RX_ADDR_P0);
-                    _NRF24L01Interface->transferBytes(&tempAddress, addressSize);
-                    _NRF24L01Interface->endTransaction();
+                    wrote = writeAddressRegister(Registers::TX_ADDR, _TXAddress, _TXAddressKnown, address, width) || wrote;
+                    // Pipe 0 receives the ACKs, so it has to match the TX address.
+                    wrote = writeAddressRegister(Registers::RX_ADDR_P0, _RXAddress, _RXAddressKnown, address, width) || wrote;
                     break;
                 }
                 case Mode::PRX: {
-                    storage[0] = address[0];
-                    storage[1] = address[1];
-                    storage[2] = address[2];
-                    storage[3] = address[3];
-                    storage[4] = address[4];
-                    
-                    _NRF24L01Interface->beginTransaction();
-                    _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::RX_ADDR_P0);
-                    _NRF24L01Interface->transferBytes(&tempAddress, addressSize);
-                    _NRF24L01Interface->endTransaction();
+                    wrote = writeAddressRegister(Registers::RX_ADDR_P0, _RXAddress, _RXAddressKnown, address, width) || wrote;
                     break;
                 }
                 default:
                     break;
             }
+            return wrote;
         }
         
         /**
@@ -269,6 +282,7 @@ namespace nRF24L01 {
          @param channel An integer from 0 to 127.
          */
         void setChannel(unsigned char channel) {
+            BusLock lock(this);
             channel = channel & Bits::BITS_RF_CH;
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::REGISTER_RF_CH);
@@ -283,6 +297,7 @@ namespace nRF24L01 {
          @param enabled `true` to enable or `false` to disable.
          */
         void setCRCEnabled(bool enabled) {
+            BusLock lock(this);
             //EN_CRC
             // Read the CONFIG register
             _NRF24L01Interface->beginTransaction();
@@ -304,6 +319,7 @@ namespace nRF24L01 {
          @param bitrate 0 for 250kbps, 1 for 1Mbps, and 2 for 2Mbps
          */
         void setBitrate(unsigned char bitrate) {
+            BusLock lock(this);
             unsigned char bits = 0;
             switch(bitrate) {
                 case 0:
@@ -338,6 +354,7 @@ namespace nRF24L01 {
          @param char retryCount An integer from 0 - 15
          */
         void setAutoRetransmitCount(unsigned char retryCount) {
+            BusLock lock(this);
             //SETUP_RETR
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::SETUP_RETR);
@@ -359,6 +376,12 @@ namespace nRF24L01 {
          @param noACK Requires dynamic ACK to be enabled. If enabled, setting this parameter to true will disable ACK for this single packet.
          */
         void startSendingPacket(unsigned char *data, unsigned char size, bool noACK = false) {
+            BusLock lock(this);
+            // A payload being reused would otherwise stay at the front of the TX FIFO and get sent again.
+            if(_TXReuseActive) {
+                cancelRepeatingPacket();
+            }
+            
             // Choose a write command based on whether or not we want an ACK
             unsigned char writeCommand = noACK ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD;//(_ACKEnabled) ? Commands::W_TX_PAYLOAD : Commands::W_TX_PAYLOAD_NO_ACK;
             
@@ -374,10 +397,135 @@ namespace nRF24L01 {
         
         
         /**
-         Ends a packet send operation. Call this in your IRQ interrupt.
+         Ends a packet send operation. Call this once the nRF reports the packet as sent or failed, e.g. from the work your IRQ interrupt passes to `submit`.
          */
         void concludeSendingPacket() {
+            BusLock lock(this);
+            _NRF24L01Interface->writeCELow();
+        }
+
+
+        /**
+         Sends a packet and waits until the nRF reports it as sent, gives up after its retransmits, or `timeoutMicroseconds` pass.
+         The bus stays owned the whole time, so nothing else can take the result, and work passed to `submit` meanwhile runs once it's done.
+         STATUS is read every `SEND_POLL_INTERVAL_MICROSECONDS` while waiting. Afterwards CE is low, TX_DS and MAX_RT are cleared and a packet that wasn't sent is flushed, so the next send starts clean.
+
+         @param data The data to send. It's overwritten by what's clocked in over SPI.
+         @param size The number of bytes to send.
+         @param noACK Requires dynamic ACK to be enabled. If enabled, setting this parameter to true will disable ACK for this single packet.
+         @param timeoutMicroseconds How long to wait at most.
+         @return `true` if the packet was sent (and acknowledged, unless it didn't ask for an ACK.)
+         */
+        bool sendPacketAndWait(unsigned char *data, unsigned char size, bool noACK = false, unsigned long timeoutMicroseconds = 100000) {
+            BusLock lock(this);
+            startSendingPacket(data, size, noACK);
+
+            unsigned long start = _NRF24L01Interface->micros();
+            unsigned char status;
+            while(true) {
+                status = readStatus();
+                if((status & (TX_DS | MAX_RT)) != 0 || _NRF24L01Interface->micros() - start > timeoutMicroseconds) {
+                    break;
+                }
+                // A send takes at least 130us to settle plus its airtime, so polling flat out would only fill the bus.
+                _NRF24L01Interface->delayMicroseconds(SEND_POLL_INTERVAL_MICROSECONDS);
+            }
+
+            // Clearing MAX_RT while CE is still high would send the failed packet again, so stop and flush it first.
             _NRF24L01Interface->writeCELow();
+            bool sent = (status & TX_DS) != 0;
+            if(!sent) {
+                flushTXFIFO();
+            }
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::STATUS);
+            _NRF24L01Interface->transferByte(TX_DS | MAX_RT);
+            _NRF24L01Interface->endTransaction();
+            _lastInterruptBits = status & (TX_DS | MAX_RT);
+            return sent;
+        }
+
+
+        /**
+         Uploads a packet once and starts sending it repeatedly, e.g. for beacons. The nRF keeps the payload (REUSE_TX_PL),
+         so each repeat only needs a pulse on the CE pin instead of sending the whole payload over SPI again.
+         Call `continueRepeatingPacket` each time a send completes (after `readAndClearInterruptBits` in the work your IRQ interrupt passes to `submit`.)
+         Sending a normal packet or flushing the TX FIFO stops the repeats.
+
+         @param data The data to send.
+         @param size The number of bytes to send.
+         @param repeats How many times to send the packet in total, or 0 to keep going until `cancelRepeatingPacket` is called.
+         @param noACK Requires dynamic ACK to be enabled. Repeated broadcasts usually don't want ACKs.
+         */
+        void startRepeatingPacket(unsigned char *data, unsigned char size, unsigned int repeats = 0, bool noACK = true) {
+            BusLock lock(this);
+            _NRF24L01Interface->writeCELow();
+            flushTXFIFO();
+            
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(noACK ? W_TX_PAYLOAD_NO_ACK : W_TX_PAYLOAD);
+            _NRF24L01Interface->transferBytes(&data, size);
+            _NRF24L01Interface->endTransaction();
+            
+            // Keep the payload in the TX FIFO after it's sent. This has to happen before the transmission starts.
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::REUSE_TX_PL);
+            _NRF24L01Interface->endTransaction();
+            
+            _TXReuseActive = true;
+            _repeatForever = repeats == 0;
+            _repeatsRemaining = repeats;
+            continueRepeatingPacket();
+        }
+
+
+        /**
+         Sends the packet passed to `startRepeatingPacket` again, if there are any repeats left. This doesn't use SPI at all.
+
+         @return `true` if another send was started, `false` once all the repeats are done or they were cancelled.
+         */
+        bool continueRepeatingPacket() {
+            BusLock lock(this);
+            if(!_TXReuseActive || (!_repeatForever && _repeatsRemaining == 0)) {
+                return false;
+            }
+            if(!_repeatForever) {
+                _repeatsRemaining--;
+            }
+            // While reusing a payload the nRF keeps sending as long as CE is high, so pulse it (at least 10us) for a single send.
+            _NRF24L01Interface->writeCEHigh();
+            _NRF24L01Interface->delayMicroseconds(10);
+            _NRF24L01Interface->writeCELow();
+            return true;
+        }
+
+
+        /**
+         Stops repeating the packet passed to `startRepeatingPacket` and removes it from the TX FIFO.
+         */
+        void cancelRepeatingPacket() {
+            BusLock lock(this);
+            _NRF24L01Interface->writeCELow();
+            flushTXFIFO();
+            _repeatsRemaining = 0;
+        }
+
+
+        /**
+         @return `true` if a packet passed to `startRepeatingPacket` still has repeats left (or repeats forever.)
+         */
+        bool isRepeatingPacket() const {
+            return _TXReuseActive && (_repeatForever || _repeatsRemaining > 0);
+        }
+
+
+        /**
+         Asks the nRF whether it's reusing the payload at the front of the TX FIFO.
+
+         @return `true` if the TX_REUSE bit of the FIFO_STATUS register is set.
+         */
+        bool isReusingTXPayload() {
+            return (getFIFOStatus() & Bits::TX_REUSE) > 0;
         }
         
         
@@ -387,6 +535,7 @@ namespace nRF24L01 {
          @return The number of bytes in the next packet (if there's a packet waiting.)
          */
         unsigned char getNextPacketSize() {
+            BusLock lock(this);
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_RX_PL_WID);
             unsigned char packetSize = _NRF24L01Interface->transferByte(0x00);
@@ -402,6 +551,7 @@ namespace nRF24L01 {
          @param length The length of the array given.
          */
         void readData(unsigned char *dataOut, unsigned char length = 0) {
+            BusLock lock(this);
             
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_RX_PAYLOAD);
@@ -414,19 +564,34 @@ namespace nRF24L01 {
          Clears all the data from the RX FIFO
          */
         void flushRXFIFO() {
+            BusLock lock(this);
             //FLUSH_RX
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::FLUSH_RX);
-            _NRF24L01Interface->transferByte(0x00);
             _NRF24L01Interface->endTransaction();
         }
-        
+
+
+        /**
+         Clears all the data from the TX FIFO
+         */
+        void flushTXFIFO() {
+            BusLock lock(this);
+            //FLUSH_TX
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::FLUSH_TX);
+            _NRF24L01Interface->endTransaction();
+            // Flushing also ends payload reuse.
+            _TXReuseActive = false;
+        }
+
         /**
          Returns the 8 bit status and 8 bit config registers as a 16 bit unsigned integer.
 
          @return ((status << 8) | config)
          */
         unsigned int getStatusAndConfigRegisters() {
+            BusLock lock(this);
             _NRF24L01Interface->beginTransaction();
             unsigned char status = _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::CONFIG);
             unsigned char config = _NRF24L01Interface->transferByte(Commands::NOP);
@@ -441,6 +606,7 @@ namespace nRF24L01 {
          @return The FIFO register contents
          */
         unsigned char getFIFOStatus() {
+            BusLock lock(this);
             //FIFO_STATUS
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::FIFO_STATUS);
@@ -456,34 +622,45 @@ namespace nRF24L01 {
          @return `true` if there's any data in the FIFO, otherwise false.
          */
         bool dataInRXFIFO() {
+            BusLock lock(this);
             _NRF24L01Interface->beginTransaction();
             _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::FIFO_STATUS);
             unsigned char fifo = _NRF24L01Interface->transferByte(Commands::NOP);
             _NRF24L01Interface->endTransaction();
-            return (fifo & 0b00000010) > 0 | (fifo & 0b00000001) == 0;
+            return ((fifo & 0b00000010) > 0) | ((fifo & 0b00000001) == 0);
         }
-        
+
+
+        /**
+         Checks the transmitting FIFO
+
+         @return `true` if there's a payload left in the FIFO (that hasn't been sent, or is still waiting for its ACK), otherwise false.
+         */
+        bool dataInTXFIFO() {
+            return (getFIFOStatus() & Bits::TX_EMPTY) == 0;
+        }
+
         
         /**
-         Gets the interrupt bits from the STATUS register and subsequently clears the interrupts bits from the STATUS register. You should call this methods from your interrupt before calling `didReceivePayload`, `didSendPayload`, and `didHitMaxRetry`. You only need to call this once per interrupt trigger though.
+         Gets the interrupt bits from the STATUS register and subsequently clears the interrupts bits from the STATUS register. Call this from the work your interrupt passes to `submit`, before calling `didReceivePayload`, `didSendPayload`, and `didHitMaxRetry`. You only need to call this once per interrupt trigger though.
+         Those three look at the bits from the last call by anyone, so when the controller is shared (with an interrupt or between threads) either test the returned bits,
+         or make the whole sequence one piece of work passed to `submit`.
 
-         @return None, see didReceivePayload, didSendPayload, and didHitMaxRetry
+         @return The interrupt bits that were set, test them with `INTERRUPT_BIT_RX_DR`, `INTERRUPT_BIT_TX_DS` and `INTERRUPT_BIT_MAX_RT`.
          */
-        void readAndClearInterruptBits() {
+        unsigned char readAndClearInterruptBits() {
+            BusLock lock(this);
             const unsigned char mask = (RX_DR | TX_DS | MAX_RT);
             
-            // Get the status register
-            _NRF24L01Interface->beginTransaction();
-            unsigned char status = _NRF24L01Interface->transferByte(Commands::NOP);
-            _NRF24L01Interface->endTransaction();
-            
-            // Clear the interrupt bits
+            // The STATUS register is clocked out while the command is sent,
+            // so only write back (and clear) the bits that were actually set.
             _NRF24L01Interface->beginTransaction();
-            _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::STATUS);
-            _NRF24L01Interface->transferByte(mask);
+            unsigned char status = _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::STATUS);
+            _NRF24L01Interface->transferByte(status & mask);
             _NRF24L01Interface->endTransaction();
             
             _lastInterruptBits = mask & status;
+            return mask & status;
         }
         
         
@@ -514,6 +691,167 @@ namespace nRF24L01 {
             return ((_lastInterruptBits & INTERRUPT_BIT_MAX_RT) > 0);
         }
         
+        /**
+         Work to run while owning the SPI bus, see `submit`.
+
+         @param controller The controller that ran the work.
+         @param context The context pointer passed to `submit`.
+         */
+        typedef void (*Work)(Controller<T> *controller, void *context);
+
+        static const unsigned char WORK_QUEUE_SIZE = 8;
+
+        // How often `sendPacketAndWait` reads STATUS while it waits.
+        static const unsigned int SEND_POLL_INTERVAL_MICROSECONDS = 20;
+
+
+        /**
+         Runs a piece of work that needs the nRF to itself, without ever waiting for the SPI bus.
+         Every public method takes ownership of the bus while it runs, so calls from the main loop (or from several threads on a host)
+         never interleave. An interrupt can't wait for the main loop to finish though, so call this from interrupts instead of calling methods directly.
+         If the bus is free the work runs right away, otherwise it's queued and run by whoever owns the bus just before they let go of it,
+         or by this call itself if the owner let go before the work got in.
+         Only single calls are safe on their own. Sequences that depend on each other, like `readAndClearInterruptBits` and then `didReceivePayload`,
+         `getNextPacketSize` and then `readData`, or `startSendingPacket` and then waiting for it to finish, can be split up by another caller,
+         so when the controller is shared run them as one piece of work passed to `submit`.
+
+         @param work The function to run. It can call any method of the controller.
+         @param context Passed on to `work`.
+         @return `false` if the bus was busy and the queue was full, so the work was dropped.
+         */
+        bool submit(Work work, void *context = 0) {
+            if(_NRF24L01Interface->tryLockBus()) {
+                _busDepth++;
+                work(this, context);
+                releaseBus();
+                return true;
+            }
+
+            bool queued = false;
+            _NRF24L01Interface->enterCritical();
+            if(_workCount < WORK_QUEUE_SIZE) {
+                QueuedWork &entry = _workQueue[(_workHead + _workCount) % WORK_QUEUE_SIZE];
+                entry.work = work;
+                entry.context = context;
+                _workCount++;
+                queued = true;
+            }
+            _NRF24L01Interface->exitCritical();
+
+            // The owner may have checked the queue and let go of the bus before the work got in, so nobody would run it.
+            if(queued && _NRF24L01Interface->tryLockBus()) {
+                _busDepth++;
+                releaseBus();
+            }
+            return queued;
+        }
+
+
+        enum class IRQMode : unsigned char {
+            // Your interrupt calls `notifyInterrupt`, `pollInterruptBits` only talks to the nRF after an interrupt.
+            Interrupt = 0,
+            // `pollInterruptBits` always reads the STATUS register. The IRQ pin isn't used.
+            Polling = 1,
+            // Interrupt driven while idle, busy polling while packets keep arriving.
+            Hybrid = 2
+        };
+
+
+        /**
+         Chooses how `pollInterruptBits` finds out about new events. In `Hybrid` mode an interrupt switches to busy polling
+         with the nRF's interrupts masked, and after `idlePollThreshold` polls in a row without any events it switches back
+         to waiting for an interrupt. This saves the per-packet interrupt overhead under heavy load without spinning while idle.
+         If the controller was created with `NO_PIN` as the IRQ pin, "waiting for an interrupt" means polling every `idlePollInterval` microseconds instead.
+
+         @param mode `Interrupt`, `Polling` or `Hybrid`.
+         @param idlePollThreshold How many empty polls in a row end busy polling (`Hybrid` only.)
+         @param idlePollInterval How often to poll while idle without an IRQ pin, in microseconds (`Hybrid` only.)
+         */
+        void setIRQMode(IRQMode mode, unsigned int idlePollThreshold = 100, unsigned long idlePollInterval = 1000) {
+            BusLock lock(this);
+            _IRQMode = mode;
+            _idlePollThreshold = idlePollThreshold;
+            _idlePollInterval = idlePollInterval;
+            _idlePolls = 0;
+            _busyPolling = mode == IRQMode::Polling;
+            setInterruptsMasked(_busyPolling);
+        }
+
+
+        /**
+         Call this from your IRQ interrupt instead of `readAndClearInterruptBits` when using `pollInterruptBits`. It doesn't talk to the nRF.
+         */
+        void notifyInterrupt() {
+            _interruptPending = true;
+        }
+
+
+        /**
+         Checks for new events without needing an interrupt routine that talks to the nRF. Call this from your loop.
+         While busy polling this costs a single 1 byte transaction when nothing happened.
+
+         @return `true` if there were new events, check them with `didReceivePayload`, `didSendPayload` and `didHitMaxRetry`.
+         */
+        bool pollInterruptBits() {
+            BusLock lock(this);
+            if(!_busyPolling) {
+                bool pending = _interruptPending;
+                _interruptPending = false;
+                if(_IRQMode == IRQMode::Interrupt) {
+                    if(!pending) {
+                        return false;
+                    }
+                    return readAndClearInterruptBits() != 0;
+                }
+                // Hybrid and idle
+                if(_IRQPin == NO_PIN) {
+                    unsigned long now = _NRF24L01Interface->micros();
+                    if(now - _lastPoll < _idlePollInterval) {
+                        return false;
+                    }
+                    _lastPoll = now;
+                } else if(!pending) {
+                    return false;
+                }
+            }
+
+            unsigned char status = readStatus();
+            if((status & (RX_DR | TX_DS | MAX_RT)) == 0) {
+                if(_busyPolling && _IRQMode == IRQMode::Hybrid && ++_idlePolls >= _idlePollThreshold) {
+                    _busyPolling = false;
+                    // Any event that arrived since the last poll pulls the IRQ pin low as soon as it's unmasked, so nothing is missed.
+                    setInterruptsMasked(false);
+                }
+                return false;
+            }
+
+            unsigned char bits = readAndClearInterruptBits();
+            _idlePolls = 0;
+            if(!_busyPolling) {
+                _busyPolling = true;
+                setInterruptsMasked(true);
+            }
+            return bits != 0;
+        }
+
+
+        /**
+         @return `true` while `pollInterruptBits` is busy polling rather than waiting for an interrupt.
+         */
+        bool isBusyPolling() const {
+            return _busyPolling;
+        }
+
+
+        /**
+         Gives access to the interface used to talk to the nRF, e.g. for its timing functions.
+
+         @return The interface instance owned by this controller.
+         */
+        T *getInterface() const {
+            return _NRF24L01Interface;
+        }
+
         static const unsigned char INTERRUPT_BIT_RX_DR = 1 << 6;
         static const unsigned char INTERRUPT_BIT_TX_DS = 1 << 5;
         static const unsigned char INTERRUPT_BIT_MAX_RT = 1 << 4;
@@ -529,6 +867,22 @@ namespace nRF24L01 {
         volatile unsigned char _lastInterruptBits;
         volatile Mode _mode;
         volatile bool _ACKEnabled;
+        volatile bool _interruptPending;
+        IRQMode _IRQMode;
+        bool _busyPolling;
+        unsigned int _idlePolls;
+        unsigned int _idlePollThreshold;
+        unsigned long _idlePollInterval;
+        unsigned long _lastPoll;
+        volatile bool _TXReuseActive;
+        volatile bool _repeatForever;
+        volatile unsigned int _repeatsRemaining;
+        // What was last written to SETUP_AW, TX_ADDR and RX_ADDR_P0 (0 width means unknown)
+        unsigned char _addressWidth;
+        unsigned char _TXAddress[5];
+        unsigned char _RXAddress[5];
+        bool _TXAddressKnown;
+        bool _RXAddressKnown;
         
         // Command constants
         enum Commands : unsigned char {
@@ -637,6 +991,137 @@ namespace nRF24L01 {
             EN_DYN_ACK = 1 << 0
         };
         
+        struct QueuedWork {
+            Work work;
+            void *context;
+        };
+
+        QueuedWork _workQueue[WORK_QUEUE_SIZE];
+        volatile unsigned char _workHead;
+        volatile unsigned char _workCount;
+        // How many times the current owner has locked the bus
+        unsigned char _busDepth;
+
+        /**
+         Owns the SPI bus for as long as it's in scope. Locks can be nested by the same owner.
+         */
+        class BusLock {
+        public:
+            BusLock(Controller<T> *controller): _controller(controller) {
+                _controller->_NRF24L01Interface->lockBus();
+                _controller->_busDepth++;
+            }
+            ~BusLock() {
+                _controller->releaseBus();
+            }
+        private:
+            Controller<T> *_controller;
+        };
+
+        /**
+         Gives up one level of bus ownership. The outermost owner runs any work that was submitted while it held the bus first.
+         */
+        void releaseBus() {
+            while(true) {
+                if(_busDepth == 1) {
+                    runQueuedWork();
+                }
+                bool outermost = --_busDepth == 0;
+                _NRF24L01Interface->unlockBus();
+                if(!outermost) {
+                    return;
+                }
+
+                // Work submitted after the queue was emptied but before the bus was unlocked would be stuck, so pick it up.
+                // The bus isn't ours anymore, so the queue can only be looked at in a critical section.
+                _NRF24L01Interface->enterCritical();
+                bool pending = _workCount != 0;
+                _NRF24L01Interface->exitCritical();
+                if(!pending || !_NRF24L01Interface->tryLockBus()) {
+                    return;
+                }
+                _busDepth++;
+            }
+        }
+
+        void runQueuedWork() {
+            while(true) {
+                _NRF24L01Interface->enterCritical();
+                if(_workCount == 0) {
+                    _NRF24L01Interface->exitCritical();
+                    return;
+                }
+                QueuedWork entry = _workQueue[_workHead];
+                _workHead = (_workHead + 1) % WORK_QUEUE_SIZE;
+                _workCount--;
+                _NRF24L01Interface->exitCritical();
+
+                entry.work(this, entry.context);
+            }
+        }
+
+        /**
+         Writes an address register, skipping whatever is already in it according to `cache`.
+         The register is written least significant byte first, so only the bytes up to the last one that changed need to be sent.
+
+         @return `false` if the register already held the address.
+         */
+        bool writeAddressRegister(unsigned char reg, unsigned char cache[5], bool &cacheKnown, const unsigned char address[], unsigned char width) {
+            unsigned char count = width;
+            if(cacheKnown) {
+                count = 0;
+                for(unsigned char i = 0; i < width; i++) {
+                    if(cache[i] != address[i]) {
+                        count = i + 1;
+                    }
+                }
+                if(count == 0) {
+                    return false;
+                }
+            }
+            
+            // Send byte by byte rather than with transferBytes, which would overwrite the address with what's clocked in.
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::W_REGISTER | reg);
+            for(unsigned char i = 0; i < count; i++) {
+                _NRF24L01Interface->transferByte(address[i]);
+                cache[i] = address[i];
+            }
+            _NRF24L01Interface->endTransaction();
+            cacheKnown = true;
+            return true;
+        }
+
+        /**
+         @return The STATUS register, clocked out while sending a NOP, in a single 1 byte transaction.
+         */
+        unsigned char readStatus() {
+            _NRF24L01Interface->beginTransaction();
+            unsigned char status = _NRF24L01Interface->transferByte(Commands::NOP);
+            _NRF24L01Interface->endTransaction();
+            return status;
+        }
+
+        /**
+         Masks or unmasks all three interrupts in the CONFIG register, so the IRQ pin stays high while we're busy polling.
+         */
+        void setInterruptsMasked(bool masked) {
+            if(_IRQPin == NO_PIN) {
+                return;
+            }
+            const unsigned char mask = Bits::MASK_RX_DR | Bits::MASK_TX_DS | Bits::MASK_MAX_RT;
+
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::R_REGISTER | Registers::CONFIG);
+            unsigned char config = _NRF24L01Interface->transferByte(Commands::NOP);
+            _NRF24L01Interface->endTransaction();
+
+            _NRF24L01Interface->beginTransaction();
+            _NRF24L01Interface->transferByte(Commands::W_REGISTER | Registers::CONFIG);
+            _NRF24L01Interface->transferByte(masked ? config | mask : config & (~mask));
+            _NRF24L01Interface->endTransaction();
+        }
+
         /**
          Used by the SPI interface to get the interrupt pin number
 
@@ -661,7 +1146,6 @@ namespace nRF24L01 {
  Interfacing notes
  
  //Add channel support
- /*
  At 2Mbps the channel occupies a bandwidth wider than the resolution of the RF channel frequency setting. To ensure non-overlapping channels in 2Mbps mode, the channel spacing must be 2MHz or more. At 1Mbps and 250kbps the channel bandwidth is the same or lower than the resolution of the RF frequency.
  */
 